@@ -24,4 +24,23 @@ int main(int argc, char* argv[]) {
     std::vector<char> uncompressed_data = compressor.uncompress<char>(sizeof(data), compressed_data);
 
     println("uncompressed data: \n{}", uncompressed_data.data());
+
+    // Compress bigger payload as independent blocks using all threads.
+    std::vector<std::uint8_t> payload;
+    for (std::size_t i = 0; i < 256; ++i) {
+        payload.insert(payload.end(), data, data + sizeof(data));
+    }
+
+    thread_pool pool;
+    stopwatch stopwatch;
+
+    std::vector<std::uint8_t> blocks = compressor.compress_blocks(pool, payload, 64 * 1024);
+    const float compress_time = stopwatch.restart();
+
+    std::vector<std::uint8_t> uncompressed_payload(compressor.blocks_uncompressed_size(blocks));
+    compressor.uncompress_blocks(pool, blocks, uncompressed_payload.data(), uncompressed_payload.size());
+    const float uncompress_time = stopwatch.restart();
+
+    println("payload size: {} blocks: {} compressed size: {} compress: {:.2f} ms uncompress: {:.2f} ms",
+        payload.size(), compressor.block_count(blocks), blocks.size(), compress_time * 1000.0f, uncompress_time * 1000.0f);
 }
@@ -0,0 +1,67 @@
+#include <rabbit/rabbit.hpp>
+
+using namespace rb;
+
+// Number of tiny tasks to run per measurement.
+static constexpr int task_count = 1 << 20;
+
+// Number of tasks spawned by each task submitted from the main thread.
+static constexpr int fan_out = 256;
+
+int main(int argc, char* argv[]) {
+    const unsigned int max_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (unsigned int thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+        thread_pool pool(thread_count);
+
+        std::atomic<int> counter = 0;
+
+        // Every task submitted from the main thread goes through the injection queue.
+        stopwatch stopwatch;
+        {
+            task_counter tasks;
+            for (int i = 0; i < task_count; ++i) {
+                pool.submit_detached(tasks, [&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+            }
+            pool.wait(tasks);
+        }
+        const float injected_time = stopwatch.restart();
+
+        // Tasks submitted from workers go to their own deques and get stolen by idle workers.
+        {
+            task_counter tasks;
+            for (int i = 0; i < task_count / fan_out; ++i) {
+                pool.submit_detached(tasks, [&pool, &tasks, &counter] {
+                    for (int j = 0; j < fan_out; ++j) {
+                        pool.submit_detached(tasks, [&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+                    }
+                });
+            }
+            pool.wait(tasks);
+        }
+        const float nested_time = stopwatch.restart();
+
+        // Every future allocates its shared state.
+        {
+            std::vector<std::future<void>> futures;
+            futures.reserve(task_count);
+            for (int i = 0; i < task_count; ++i) {
+                futures.push_back(pool.submit([&counter] { counter.fetch_add(1, std::memory_order_relaxed); }));
+            }
+            for (std::future<void>& future : futures) {
+                future.get();
+            }
+        }
+        const float future_time = stopwatch.restart();
+
+        // Sort pseudo-random integers, the calling thread helps with blocks and merges.
+        std::vector<unsigned int> values(task_count);
+        parallel_for(pool, 0, task_count, [&values](int i) { values[i] = unsigned(i) * 2654435761u; });
+        stopwatch.restart();
+        parallel_sort(pool, values.begin(), values.end());
+        const float sort_time = stopwatch.restart();
+
+        println("threads: {:>3} injected: {:>12.0f} tasks/s nested: {:>12.0f} tasks/s futures: {:>12.0f} tasks/s sort: {:>8.2f} ms",
+            thread_count, task_count / injected_time, task_count / nested_time, task_count / future_time, sort_time * 1000.0f);
+    }
+}
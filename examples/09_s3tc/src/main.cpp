@@ -0,0 +1,113 @@
+#include <rabbit/rabbit.hpp>
+
+#include <rgbcx.hpp>
+
+#include <cmath>
+
+using namespace rb;
+
+// Size of encoded texture, e.g. a large atlas.
+static constexpr std::size_t texture_size = 2048;
+
+// Root mean square error of decoded blocks against source pixels over given channels.
+static double rmse(const std::vector<std::uint8_t>& pixels, const std::vector<std::uint8_t>& blocks, std::size_t block_size, int channels) {
+    const std::size_t blocks_x = texture_size / 4;
+    std::uint8_t decoded[16 * 4];
+    double error = 0.0;
+
+    for (std::size_t block = 0; block < blocks.size() / block_size; ++block) {
+        if (block_size == 8) {
+            rgbcx::unpack_bc1(&blocks[block * block_size], decoded);
+        } else {
+            rgbcx::unpack_bc3(&blocks[block * block_size], decoded);
+        }
+
+        const std::size_t x = block % blocks_x * 4;
+        const std::size_t y = block / blocks_x * 4;
+
+        for (std::size_t i = 0; i < 16; ++i) {
+            const std::uint8_t* pixel = &pixels[((y + i / 4) * texture_size + x + i % 4) * 4];
+            for (int c = 0; c < channels; ++c) {
+                const double difference = double(pixel[c]) - double(decoded[i * 4 + c]);
+                error += difference * difference;
+            }
+        }
+    }
+
+    return std::sqrt(error / (double(texture_size) * texture_size * channels));
+}
+
+int main(int argc, char* argv[]) {
+    // Smooth gradients with noise and alpha, so blocks are not trivially solid.
+    std::vector<std::uint8_t> pixels(texture_size * texture_size * 4);
+    for (std::size_t y = 0; y < texture_size; ++y) {
+        for (std::size_t x = 0; x < texture_size; ++x) {
+            std::uint8_t* pixel = &pixels[(y * texture_size + x) * 4];
+            const std::uint32_t noise = std::uint32_t(y * texture_size + x) * 2654435761u;
+
+            pixel[0] = std::uint8_t(x * 255 / texture_size);
+            pixel[1] = std::uint8_t(y * 255 / texture_size);
+            pixel[2] = std::uint8_t(127.5f + 127.5f * std::sin(float(x + y) * 0.05f)) ^ std::uint8_t(noise >> 29);
+            pixel[3] = std::uint8_t(255 - (noise >> 28));
+        }
+    }
+
+    const std::size_t stride = texture_size * 4;
+    const float megapixels = float(texture_size * texture_size) / 1e6f;
+
+    std::vector<std::uint8_t> bc1(texture_size * texture_size / 2);
+    std::vector<std::uint8_t> bc3(texture_size * texture_size);
+
+    // Quality tiers on a single thread. RMSE of BC1 is over RGB, of BC3 over RGBA.
+    const std::pair<s3tc_quality, const char*> qualities[] = {
+        { s3tc_quality::fast, "fast" }, { s3tc_quality::normal, "normal" }, { s3tc_quality::best, "best" }
+    };
+
+    // First encode initializes encoder tables, keep it out of measurements.
+    s3tc().bc1(pixels.data(), stride * 4, stride, bc1.data());
+
+    for (const auto& [quality, name] : qualities) {
+        const s3tc encoder{ quality };
+
+        stopwatch stopwatch;
+        encoder.bc1(pixels.data(), pixels.size(), stride, bc1.data());
+        const float bc1_time = stopwatch.restart();
+        encoder.bc3(pixels.data(), pixels.size(), stride, bc3.data());
+        const float bc3_time = stopwatch.restart();
+
+        println("quality: {:<6} bc1: {:>8.2f} MPix/s rmse: {:>6.3f} bc3: {:>8.2f} MPix/s rmse: {:>6.3f}",
+            name, megapixels / bc1_time, rmse(pixels, bc1, 8, 3), megapixels / bc3_time, rmse(pixels, bc3, 16, 4));
+    }
+
+    // Scaling of parallel encoding with normal quality.
+    const s3tc encoder;
+
+    std::vector<std::uint8_t> serial_bc1(bc1.size());
+    std::vector<std::uint8_t> serial_bc3(bc3.size());
+
+    stopwatch stopwatch;
+    encoder.bc1(pixels.data(), pixels.size(), stride, serial_bc1.data());
+    const float serial_bc1_time = stopwatch.restart();
+    encoder.bc3(pixels.data(), pixels.size(), stride, serial_bc3.data());
+    const float serial_bc3_time = stopwatch.restart();
+
+    println("serial      bc1: {:>8.2f} ms bc3: {:>8.2f} ms", serial_bc1_time * 1000.0f, serial_bc3_time * 1000.0f);
+
+    const unsigned int max_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (unsigned int thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+        thread_pool pool(thread_count);
+
+        std::size_t progress_calls = 0;
+
+        stopwatch.restart();
+        encoder.bc1(pool, pixels.data(), pixels.size(), stride, bc1.data(), [&](std::size_t, std::size_t) { ++progress_calls; });
+        const float bc1_time = stopwatch.restart();
+        encoder.bc3(pool, pixels.data(), pixels.size(), stride, bc3.data());
+        const float bc3_time = stopwatch.restart();
+
+        println("threads: {:>3} bc1: {:>8.2f} ms ({:>5.2f}x) bc3: {:>8.2f} ms ({:>5.2f}x) identical: {} progress reports: {}",
+            thread_count, bc1_time * 1000.0f, serial_bc1_time / bc1_time, bc3_time * 1000.0f, serial_bc3_time / bc3_time,
+            bc1 == serial_bc1 && bc3 == serial_bc3, progress_calls);
+    }
+}
@@ -0,0 +1,63 @@
+#include <rabbit/rabbit.hpp>
+
+using namespace rb;
+
+#ifndef RB_COROUTINES
+#   error "Coroutines example needs a compiler with C++20 coroutines."
+#endif
+
+// Port of the local server, the client connects to it from the same thread.
+static constexpr unsigned short port = 6970;
+
+struct greeting_packet {
+    int value = 0;
+};
+
+// Walks through every kind of suspension: a pool hop, a file read, next frame and network messages.
+static task<> run(thread_pool& pool, frame_scheduler& scheduler, client& client, inbox<client_event_connect>& connected, inbox<greeting_packet>& greetings, const char* path, bool& done) {
+    const std::thread::id main_thread = std::this_thread::get_id();
+
+    co_await schedule_on(pool);
+    println("running on worker: {}", std::this_thread::get_id() != main_thread);
+
+    const std::vector<unsigned char> content = co_await read_file(pool, path);
+    println("read {} bytes of {}", content.size(), path);
+
+    co_await next_frame(scheduler);
+    println("back on main thread: {}", std::this_thread::get_id() == main_thread);
+
+    // Both inboxes resume the coroutine inside dispatch of their endpoint on the main thread.
+    co_await connected.receive();
+    println("connected");
+
+    client.send(greeting_packet{ int(content.size()) });
+
+    const greeting_packet greeting = co_await greetings.receive();
+    println("server received {}", greeting.value);
+
+    done = true;
+}
+
+int main(int argc, char* argv[]) {
+    thread_pool pool(2);
+    frame_scheduler scheduler;
+
+    server server(port);
+    client client("127.0.0.1", port);
+
+    inbox<client_event_connect> connected(client);
+    inbox<greeting_packet> greetings(server);
+
+    bool done = false;
+
+    // Executable itself is a file that always exists.
+    run(pool, scheduler, client, connected, greetings, argv[0], done).detach();
+
+    while (!done) {
+        scheduler.dispatch();
+        server.dispatch();
+        client.dispatch();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
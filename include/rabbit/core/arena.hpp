@@ -2,15 +2,33 @@
 
 #include "handle.hpp"
 
+#include <memory>
+#include <vector>
 #include <cassert>
+#include <utility>
+#include <functional>
 #include <type_traits>
 
 namespace rb {
     /**
      * @brief Region-based fixed-size memory allocator. Mainly used for sharing data between CPU and GPU.
      *        Better performance should be achieved with plain-old-data types.
+     *
+     *        Handles are versioned: once an object is destroyed every handle to it becomes invalid,
+     *        even if its slot gets recycled later. Iteration costs O(live) in both storage modes.
+     *
+     *        With zero page size (default) data is kept densely packed and iteration walks memory contiguously.
+     *        Destroying an object moves the last element into its place and growing reallocates,
+     *        so references to data do not survive create/destroy calls.
+     *
+     *        With non-zero page size data is stored in fixed-size pages indexed by handle slot.
+     *        Growing allocates a new page and never moves existing objects,
+     *        so references stay valid until the object is destroyed.
+     *
+     * @tparam T Type of stored objects.
+     * @tparam PageSize Number of objects per page or zero for packed storage.
      */
-    template<class T>
+    template<class T, std::size_t PageSize = 0>
     class arena {
     public:
         /**
@@ -21,22 +39,26 @@ namespace rb {
         /**
          * @brief Disabled copy constructor.
          */
-        arena(const arena<T>&) = delete;
+        arena(const arena<T, PageSize>&) = delete;
 
         /**
-         * @brief Enabled move constructor.
+         * @brief Enabled move constructor. The moved-from arena is left empty.
          */
-        arena(arena<T>&&) noexcept = default;
+        arena(arena<T, PageSize>&& other) noexcept
+            : m_sparse(std::move(other.m_sparse))
+            , m_dense(std::move(other.m_dense))
+            , m_disposed(other.m_disposed)
+            , m_data(std::move(other.m_data)) {
+            other.reset();
+        }
 
         /**
-         * @brief Destructor of the arena<T>.
+         * @brief Destructor of the arena.
          */
         ~arena() {
-            if constexpr (!std::is_standard_layout_v<T> || !std::is_trivial_v<T>) {
-                for (std::size_t i = 0, size = m_pool.size(); i < size; ++i) {
-                    if (m_pool[i] == handle(i)) {
-                        std::destroy_at(std::launder(reinterpret_cast<T*>(&m_data[i])));
-                    }
+            if constexpr (is_paged) {
+                for (handle id : m_dense) {
+                    std::destroy_at(&slot(handle_index(id)));
                 }
             }
         }
@@ -44,21 +66,39 @@ namespace rb {
         /**
          * @brief Disabled copy assignment.
          */
-        arena<T>& operator=(const arena<T>&) = delete;
+        arena<T, PageSize>& operator=(const arena<T, PageSize>&) = delete;
 
         /**
-         * @brief Enabled move assignment.
+         * @brief Enabled move assignment. Objects previously owned by
+         *        this arena are destroyed, the moved-from arena is left empty.
          */
-        arena<T>& operator=(arena<T>&&) noexcept = default;
+        arena<T, PageSize>& operator=(arena<T, PageSize>&& other) noexcept {
+            if (this != &other) {
+                [[maybe_unused]] arena<T, PageSize> previous(std::move(*this));
+
+                m_sparse = std::move(other.m_sparse);
+                m_dense = std::move(other.m_dense);
+                m_disposed = other.m_disposed;
+                m_data = std::move(other.m_data);
+                other.reset();
+            }
+
+            return *this;
+        }
 
         /**
          * @brief Get data attached to id.
-         * 
+         *
          * @return Data attached to id.
          */
         const T& operator[](handle id) const {
             assert(valid(id));
-            return *std::launder(reinterpret_cast<const T*>(&m_data[std::size_t(id)]));
+
+            if constexpr (is_paged) {
+                return slot(handle_index(id));
+            } else {
+                return m_data[position(id)];
+            }
         }
 
         /**
@@ -68,22 +108,28 @@ namespace rb {
          */
         T& operator[](handle id) {
             assert(valid(id));
-            return *std::launder(reinterpret_cast<T*>(&m_data[std::size_t(id)]));
+
+            if constexpr (is_paged) {
+                return slot(handle_index(id));
+            } else {
+                return m_data[position(id)];
+            }
         }
 
-        /** 
+        /**
          * @brief Iterates id and data and applies the given function
          *        object to them.
-         * 
+         *
          * @tparam Func Type of the function object to invoke.
          * @param func A valid function object.
          */
         template<typename Func>
         void each(Func func) {
-            for (std::size_t i = 0, size = m_pool.size(); i < size; ++i) {
-                if (m_pool[i] == handle(i)) {
-                    auto& data = *std::launder(reinterpret_cast<T*>(&m_data[i]));
-                    std::invoke(func, m_pool[i], data);
+            for (std::size_t i = 0, size = m_dense.size(); i < size; ++i) {
+                if constexpr (is_paged) {
+                    std::invoke(func, m_dense[i], slot(handle_index(m_dense[i])));
+                } else {
+                    std::invoke(func, m_dense[i], m_data[i]);
                 }
             }
         }
@@ -97,100 +143,201 @@ namespace rb {
          */
         template<typename Func>
         void each(Func func) const {
-            for (std::size_t i = 0, size = m_pool.size(); i < size; ++i) {
-                if (m_pool[i] == handle(i)) {
-                    const auto& data = *std::launder(reinterpret_cast<const T*>(&m_data[i]));
-                    std::invoke(func, m_pool[i], data);
+            for (std::size_t i = 0, size = m_dense.size(); i < size; ++i) {
+                if constexpr (is_paged) {
+                    std::invoke(func, m_dense[i], std::as_const(slot(handle_index(m_dense[i]))));
+                } else {
+                    std::invoke(func, m_dense[i], m_data[i]);
                 }
             }
         }
 
         /**
-         * @brief Create and construct new object. 
+         * @brief Create and construct new object.
          */
         template<class... Args>
         handle create(Args&&... args) {
-            const auto id = acquire();
-            
-            if (std::size_t(id) == m_data.size()) {
-                m_data.emplace_back();
-            }
-            
-            // For POD types it is not required to run constructor unless arguments are not provided.
-            if constexpr ((!std::is_standard_layout_v<T> || !std::is_trivial_v<T>) || sizeof...(Args) > 0) {
-                ::new (const_cast<void*>(static_cast<const volatile void*>(&m_data[std::size_t(id)])))
-                    T(std::forward<Args>(args)...);
+            if constexpr (is_paged) {
+                const std::size_t index = m_disposed == null ? m_sparse.size() : handle_index(m_disposed);
+
+                if (index / PageSize == m_data.size()) {
+                    m_data.push_back(std::make_unique<storage_type[]>(PageSize));
+                }
+
+                if constexpr (std::is_aggregate_v<T>) {
+                    ::new (static_cast<void*>(&m_data[index / PageSize][index % PageSize])) T{ std::forward<Args>(args)... };
+                } else {
+                    ::new (static_cast<void*>(&m_data[index / PageSize][index % PageSize])) T(std::forward<Args>(args)...);
+                }
+            } else if constexpr (std::is_aggregate_v<T>) {
+                m_data.push_back(T{ std::forward<Args>(args)... });
+            } else {
+                m_data.emplace_back(std::forward<Args>(args)...);
             }
 
-            return id;
+            return acquire();
         }
 
         /**
          * @brief Destroy an object.
-         * 
-         * @warning Changing data of identifier being destroyed can result in undefined behavior.
+         *
+         * @warning In packed mode destroying an object moves the last object into the freed place.
          */
         void destroy(handle id) {
             assert(valid(id));
 
-            if constexpr (!std::is_standard_layout_v<T> || !std::is_trivial_v<T>) {
-                std::destroy_at(std::launder(reinterpret_cast<T*>(&m_data[std::size_t(id)])));
+            const std::size_t pos = position(id);
+            const std::size_t last = m_dense.size() - 1;
+
+            if constexpr (is_paged) {
+                std::destroy_at(&slot(handle_index(id)));
+            } else if (pos != last) {
+                m_data[pos] = std::move(m_data[last]);
+            }
+
+            if (pos != last) {
+                m_dense[pos] = m_dense[last];
+                m_sparse[handle_index(m_dense[pos])] = handle_traits::construct(handle_traits::entity_type(pos), handle_version(m_dense[pos]));
+            }
+
+            if constexpr (!is_paged) {
+                m_data.pop_back();
             }
 
+            m_dense.pop_back();
+
             dispose(id);
         }
 
         /**
          * @brief Checks if an identifier refers to a valid data.
-         * 
+         *
          * @return True if id is valid, false otherwise.
          */
         bool valid(handle id) const {
-            return std::size_t(id) < m_pool.size() && m_pool[std::size_t(id)] == id;
+            const std::size_t index = handle_index(id);
+            if (index >= m_sparse.size()) {
+                return false;
+            }
+
+            const std::size_t pos = handle_index(m_sparse[index]);
+            return pos < m_dense.size() && m_dense[pos] == id;
+        }
+
+        /**
+         * @brief Get number of live objects.
+         *
+         * @return Number of live objects.
+         */
+        [[nodiscard]] std::size_t size() const {
+            return m_dense.size();
         }
 
     private:
         /**
-         * @brief Acquire new free id.
-         * 
+         * @brief Tell whether objects are stored in fixed-size pages.
+         */
+        static constexpr bool is_paged = PageSize > 0;
+
+        /**
+         * @brief Uninitialized storage for a single object within a page.
+         */
+        using storage_type = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+        /**
+         * @brief Get object stored in the slot of a page.
+         *
+         * @param index Slot index of a live object.
+         *
+         * @return Object stored in the slot.
+         */
+        T& slot(std::size_t index) const {
+            return *std::launder(reinterpret_cast<T*>(&m_data[index / PageSize][index % PageSize]));
+        }
+
+        /**
+         * @brief Forget all objects and free slots without destroying objects.
+         *        Used on moved-from arenas, which no longer own any object.
+         */
+        void reset() {
+            m_sparse.clear();
+            m_dense.clear();
+            m_disposed = null;
+            m_data.clear();
+        }
+
+        /**
+         * @brief Get position of the data in the dense containers.
+         *
+         * @param id Valid identifier.
+         *
+         * @return Dense position.
+         */
+        std::size_t position(handle id) const {
+            return handle_index(m_sparse[handle_index(id)]);
+        }
+
+        /**
+         * @brief Acquire new free id and attach it to the last dense position.
+         *
          * @return Free id.
          */
         handle acquire() {
+            const auto pos = handle_traits::entity_type(m_dense.size());
+
             if (m_disposed == null) {
-                return m_pool.emplace_back(handle(m_pool.size()));
+                assert(m_sparse.size() < handle_traits::to_entity(null) && "Out of handles");
+
+                const handle id = handle_traits::construct(handle_traits::entity_type(m_sparse.size()), 0);
+                m_sparse.push_back(handle_traits::construct(pos, 0));
+                return m_dense.emplace_back(id);
             }
 
-            const handle recycled_id = m_disposed;
-            m_disposed = m_pool[std::size_t(m_disposed)];
-            return m_pool[std::size_t(recycled_id)] = recycled_id;
+            const auto index = handle_index(m_disposed);
+            const handle id = handle_traits::construct(index, handle_version(m_sparse[index]));
+            m_disposed = handle_traits::construct(handle_index(m_sparse[index]), 0);
+            m_sparse[index] = handle_traits::construct(pos, handle_version(id));
+            return m_dense.emplace_back(id);
         }
 
         /**
-         * @brief Dispose id.
+         * @brief Dispose id. Bumps generation of the slot, so every
+         *        outstanding copy of the id becomes invalid.
          *
          * @param id Id to dispose.
          */
         void dispose(handle id) {
-            assert(valid(id));
+            const auto index = handle_index(id);
+            const auto version = handle_version(id) + 1;
+
+            // Highest version is reserved for null handle.
+            const auto next_version = version == handle_version(null) ? 0 : version;
 
-            m_pool[std::size_t(id)] = m_disposed;
-            m_disposed = id;
+            m_sparse[index] = handle_traits::construct(handle_index(m_disposed), handle_traits::version_type(next_version));
+            m_disposed = handle_traits::construct(index, 0);
         }
 
     private:
         /**
-         * @brief ID pool.
+         * @brief Slot index to dense position (live) or to next disposed slot (free),
+         *        combined with current generation of the slot.
+         */
+        std::vector<handle> m_sparse;
+
+        /**
+         * @brief Densely packed identifiers of live objects.
          */
-        std::vector<handle> m_pool;
+        std::vector<handle> m_dense;
 
         /**
-         * @brief Last disposed ID.
+         * @brief Last disposed slot.
          */
         handle m_disposed = null;
 
         /**
-         * @brief Data linear container with explicit creation/destruction.
+         * @brief Densely packed data parallel to the dense identifiers
+         *        or fixed-size pages indexed by slot index.
          */
-        std::vector<std::aligned_storage_t<sizeof(T), alignof(T)>> m_data;
+        std::conditional_t<is_paged, std::vector<std::unique_ptr<storage_type[]>>, std::vector<T>> m_data;
     };
 }
@@ -0,0 +1,115 @@
+#pragma once 
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+namespace rb {
+    /**
+     * @brief Identifier of an asset, 64-bit hash of its path together with the path itself.
+     *        Hash is computed at compile time for string literals, so lookups with
+     *        constexpr identifiers do not hash nor allocate.
+     *
+     * @warning Identifier views the path, so the path must outlive the identifier.
+     *          Use assets::intern for paths built at runtime.
+     */
+    class asset_id {
+    public:
+        /**
+         * @brief Construct an identifier of a path.
+         *
+         * @param path Path to the asset.
+         */
+        constexpr asset_id(std::string_view path)
+            : m_hash(hash(path)), m_path(path) {
+        }
+
+        /**
+         * @brief Construct an identifier of a null-terminated path.
+         *
+         * @param path Path to the asset.
+         */
+        constexpr asset_id(const char* path)
+            : asset_id(std::string_view(path)) {
+        }
+
+        /**
+         * @brief Construct an identifier of a path.
+         *
+         * @param path Path to the asset.
+         */
+        asset_id(const std::string& path)
+            : asset_id(std::string_view(path)) {
+        }
+
+        /**
+         * @brief Get hash of the path.
+         *
+         * @return Hash of the path.
+         */
+        [[nodiscard]] constexpr std::uint64_t value() const {
+            return m_hash;
+        }
+
+        /**
+         * @brief Get path to the asset.
+         *
+         * @return Path to the asset.
+         */
+        [[nodiscard]] constexpr std::string_view path() const {
+            return m_path;
+        }
+
+        /**
+         * @brief Hash a path with 64-bit FNV-1a.
+         *
+         * @param path Path to hash.
+         *
+         * @return Hash of the path.
+         */
+        [[nodiscard]] static constexpr std::uint64_t hash(std::string_view path) {
+            std::uint64_t hash = 0xcbf29ce484222325;
+            for (char c : path) {
+                hash = (hash ^ (unsigned char)c) * 0x100000001b3;
+            }
+            return hash;
+        }
+
+        /**
+         * @brief Compare identifiers by hash.
+         */
+        [[nodiscard]] constexpr bool operator==(const asset_id& other) const {
+            return m_hash == other.m_hash;
+        }
+
+        /**
+         * @brief Compare identifiers by hash.
+         */
+        [[nodiscard]] constexpr bool operator!=(const asset_id& other) const {
+            return m_hash != other.m_hash;
+        }
+
+    private:
+        /**
+         * @brief Hash of the path.
+         */
+        std::uint64_t m_hash;
+
+        /**
+         * @brief Path to the asset.
+         */
+        std::string_view m_path;
+    };
+}
+
+namespace std {
+    template<>
+    struct hash<rb::asset_id> {
+        std::size_t operator()(const rb::asset_id& id) const noexcept {
+            // Already a good hash, no need to mix again.
+            return (std::size_t)id.value();
+        }
+    };
+}
@@ -0,0 +1,292 @@
+#pragma once 
+
+#include "type_info.hpp"
+#include "stopwatch.hpp"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <string_view>
+
+namespace rb {
+    /**
+     * @brief Cost of loading a single asset. Times are in seconds.
+     */
+    struct asset_metrics {
+        /**
+         * @brief Bytes read from disk or pack.
+         */
+        std::size_t bytes_read = 0;
+
+        /**
+         * @brief Time spent opening and reading files.
+         */
+        float read_time = 0.0f;
+
+        /**
+         * @brief Time spent decoding, excluding reads.
+         */
+        float decode_time = 0.0f;
+
+        /**
+         * @brief Time spent finishing on the main thread (e.g. uploading to GPU), excluding reads.
+         */
+        float upload_time = 0.0f;
+
+        /**
+         * @brief Get total time spent loading.
+         *
+         * @return Total time in seconds.
+         */
+        [[nodiscard]] float total_time() const {
+            return read_time + decode_time + upload_time;
+        }
+
+        /**
+         * @brief Accumulate metrics.
+         */
+        asset_metrics& operator+=(const asset_metrics& other) {
+            bytes_read += other.bytes_read;
+            read_time += other.read_time;
+            decode_time += other.decode_time;
+            upload_time += other.upload_time;
+            return *this;
+        }
+    };
+
+    /**
+     * @brief Measures a load phase running on the calling thread.
+     *
+     *        Metrics are tracked per thread, so loads decoded concurrently on the thread pool
+     *        are attributed to their own asset. Elapsed time is added to the given phase
+     *        once the scope ends, minus time spent in reads reported meanwhile.
+     */
+    class asset_metrics_scope {
+    public:
+        /**
+         * @brief Start measuring a phase.
+         *
+         * @param metrics Metrics of the asset being loaded.
+         * @param phase Phase to add elapsed time to.
+         */
+        asset_metrics_scope(asset_metrics& metrics, float asset_metrics::* phase);
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        asset_metrics_scope(const asset_metrics_scope&) = delete;
+
+        /**
+         * @brief Add elapsed time to the phase.
+         */
+        ~asset_metrics_scope();
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        asset_metrics_scope& operator=(const asset_metrics_scope&) = delete;
+
+        /**
+         * @brief Report a file read to the asset loaded on the calling thread.
+         *        Does nothing if no asset is being loaded.
+         *
+         * @param bytes Number of bytes read.
+         * @param time Time spent reading in seconds.
+         */
+        static void read(std::size_t bytes, float time);
+
+    private:
+        /**
+         * @brief Metrics of the asset being loaded.
+         */
+        asset_metrics& m_metrics;
+
+        /**
+         * @brief Phase to add elapsed time to.
+         */
+        float asset_metrics::* m_phase;
+
+        /**
+         * @brief Read time when the scope started.
+         */
+        float m_read_time;
+
+        /**
+         * @brief Scope that was active on the thread before.
+         */
+        asset_metrics* m_previous;
+
+        /**
+         * @brief Measures elapsed time.
+         */
+        stopwatch m_stopwatch;
+    };
+
+    /**
+     * @brief Aggregated metrics of loaded assets, per asset type.
+     *
+     *        Optionally keeps a trace of the longest loads. Report can be printed as text
+     *        or written as JSON to compare between builds.
+     */
+    class asset_report {
+    public:
+        /**
+         * @brief Metrics of a single asset type.
+         */
+        struct type_totals {
+            /**
+             * @brief Name of the asset type.
+             */
+            std::string_view name;
+
+            /**
+             * @brief Number of loads, including failed ones.
+             */
+            std::size_t loads = 0;
+
+            /**
+             * @brief Number of requests served from cache.
+             */
+            std::size_t hits = 0;
+
+            /**
+             * @brief Number of requests sharing a load already in progress.
+             */
+            std::size_t joins = 0;
+
+            /**
+             * @brief Number of failed loads.
+             */
+            std::size_t failures = 0;
+
+            /**
+             * @brief Summed metrics of all loads.
+             */
+            asset_metrics metrics;
+        };
+
+        /**
+         * @brief Traced load.
+         */
+        struct load_record {
+            /**
+             * @brief Path to the asset.
+             */
+            std::string path;
+
+            /**
+             * @brief Name of the asset type.
+             */
+            std::string_view type;
+
+            /**
+             * @brief Metrics of the load.
+             */
+            asset_metrics metrics;
+        };
+
+        /**
+         * @brief Name an asset type.
+         *
+         * @param type Index of the asset type.
+         * @param name Name of the asset type. Must outlive the report.
+         */
+        void name(id_type type, std::string_view name);
+
+        /**
+         * @brief Record a cache hit.
+         *
+         * @param type Index of the asset type.
+         */
+        void hit(id_type type);
+
+        /**
+         * @brief Record a request sharing a load already in progress.
+         *
+         * @param type Index of the asset type.
+         */
+        void join(id_type type);
+
+        /**
+         * @brief Record a finished load.
+         *
+         * @param path Path to the asset.
+         * @param type Index of the asset type.
+         * @param metrics Metrics of the load.
+         * @param loaded True if the asset has been loaded, false if loading failed.
+         */
+        void load(std::string_view path, id_type type, const asset_metrics& metrics, bool loaded);
+
+        /**
+         * @brief Keep a trace of the longest loads. Tracing is disabled by default.
+         *
+         * @param count Number of loads to keep, zero disables the trace.
+         */
+        void set_trace(std::size_t count);
+
+        /**
+         * @brief Get metrics of asset types that have been used.
+         *
+         * @return Metrics per asset type, sorted by name.
+         */
+        [[nodiscard]] std::vector<type_totals> types() const;
+
+        /**
+         * @brief Get metrics summed over all asset types.
+         *
+         * @return Summed metrics.
+         */
+        [[nodiscard]] type_totals total() const;
+
+        /**
+         * @brief Get traced loads.
+         *
+         * @return Longest loads, longest first.
+         */
+        [[nodiscard]] std::vector<load_record> trace() const;
+
+        /**
+         * @brief Format the report as a human readable table.
+         *
+         * @return Formatted report.
+         */
+        [[nodiscard]] std::string to_string() const;
+
+        /**
+         * @brief Format the report as JSON. Times are in milliseconds.
+         *
+         * @return Formatted report.
+         */
+        [[nodiscard]] std::string to_json() const;
+
+        /**
+         * @brief Reset all metrics and traced loads.
+         */
+        void clear();
+
+    private:
+        /**
+         * @brief Get metrics of asset type, registering it if needed.
+         *
+         * @param type Index of the asset type.
+         *
+         * @return Metrics of the asset type.
+         */
+        type_totals& totals(id_type type);
+
+        /**
+         * @brief Metrics indexed by type index.
+         */
+        std::vector<type_totals> m_types;
+
+        /**
+         * @brief Longest loads kept as a min-heap by total time.
+         */
+        std::vector<load_record> m_trace;
+
+        /**
+         * @brief Number of loads to keep in trace.
+         */
+        std::size_t m_trace_size = 0;
+    };
+}
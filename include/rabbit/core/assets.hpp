@@ -1,67 +1,598 @@
 #pragma once 
 
+#include "asset_id.hpp"
+#include "asset_report.hpp"
 #include "reference.hpp"
 #include "type_info.hpp"
+#include "thread_pool.hpp"
 
-#include <map>
+#include <list>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <atomic>
 #include <string>
 #include <memory>
+#include <vector>
+#include <utility>
+#include <cassert>
 #include <functional>
 #include <string_view>
+#include <type_traits>
+#include <unordered_map>
 
 namespace rb {
+    /**
+     * @brief State of an asynchronous asset load. Shared by all requests of the same asset.
+     */
+    class asset_request : public reference {
+        friend class assets;
+
+    public:
+        /**
+         * @brief Tell whether the asset has been loaded.
+         *
+         * @return True if loaded, false otherwise.
+         */
+        [[nodiscard]] bool ready() const {
+            return m_state.load(std::memory_order_acquire) == state::ready;
+        }
+
+        /**
+         * @brief Tell whether loading the asset has failed.
+         *
+         * @return True if failed, false otherwise.
+         */
+        [[nodiscard]] bool failed() const {
+            return m_state.load(std::memory_order_acquire) == state::failed;
+        }
+
+        /**
+         * @brief Get path of the asset.
+         *
+         * @return Path of the asset.
+         */
+        [[nodiscard]] const std::string& path() const {
+            return m_path;
+        }
+
+    protected:
+        /**
+         * @brief Progress of the request.
+         */
+        enum class state {
+            pending,
+            ready,
+            failed
+        };
+
+        /**
+         * @brief Construct a new pending request.
+         *
+         * @param path Path to the asset.
+         */
+        explicit asset_request(std::string_view path, id_type type)
+            : m_path(path), m_type(type) {
+        }
+
+        /**
+         * @brief Loaded asset.
+         */
+        ref<reference> m_asset;
+
+    private:
+        /**
+         * @brief Progress of the request.
+         */
+        std::atomic<state> m_state = state::pending;
+
+        /**
+         * @brief Path to the asset.
+         */
+        std::string m_path;
+
+        /**
+         * @brief Index of the asset type.
+         */
+        id_type m_type;
+
+        /**
+         * @brief Function finishing the asset on the main thread, set once decoded.
+         */
+        std::function<ref<reference>()> m_finish;
+
+        /**
+         * @brief Metrics of the load, written by the decoding thread before finishing.
+         */
+        asset_metrics m_metrics;
+    };
+
+    /**
+     * @brief Asset that is being loaded asynchronously.
+     *
+     * @tparam Asset Type of the asset.
+     */
+    template<typename Asset>
+    class asset_future : public asset_request {
+    public:
+        /**
+         * @brief Construct a new pending request.
+         *
+         * @param path Path to the asset.
+         */
+        explicit asset_future(std::string_view path)
+            : asset_request(path, type_index<Asset>::value()) {
+        }
+
+        /**
+         * @brief Get loaded asset.
+         *
+         * @return Loaded asset or null reference if not ready.
+         */
+        [[nodiscard]] ref<Asset> get() const {
+            return ready() ? ref<Asset>(static_cast<Asset*>(m_asset.get())) : nullptr;
+        }
+
+        /**
+         * @brief Get loaded asset or placeholder until it is ready.
+         *
+         * @param placeholder Asset to use until the asset is loaded.
+         *
+         * @return Loaded asset or placeholder.
+         */
+        [[nodiscard]] ref<Asset> get_or(const ref<Asset>& placeholder) const {
+            return ready() ? ref<Asset>(static_cast<Asset*>(m_asset.get())) : placeholder;
+        }
+    };
+
     /**
      * @brief Utility class to manage assets.
+     *
+     *        Assets can be loaded synchronously or asynchronously. Asynchronous loads read
+     *        and decode on the thread pool and are finished (e.g. uploaded to GPU) on the main
+     *        thread by dispatch, which respects a time budget. Loaders split into two phases
+     *        by providing decode(path) and finish(decoded) members, other loaders run entirely
+     *        on the main thread during dispatch.
+     *
+     *        Memory used by loaded assets can be limited per asset type. Assets providing
+     *        memory_size() are accounted, and once a type exceeds its budget the least recently
+     *        used assets referenced only by the cache are evicted. Evicted assets are loaded
+     *        again on next request.
+     *
+     *        Assets are identified by asset_id, a hash of the path. Cache hits with identifiers
+     *        computed at compile time or interned once cost a single hash table probe.
+     *
+     *        Every load is measured and aggregated per asset type into a report, see report().
      */
     class assets {
     public:
+        /**
+         * @brief Construct assets manager without a thread pool.
+         *        Asynchronous loads decode on the calling thread.
+         */
+        assets() = default;
+
+        /**
+         * @brief Construct assets manager decoding asynchronous loads on the thread pool.
+         *
+         * @param pool Thread pool to decode on.
+         */
+        explicit assets(thread_pool& pool);
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        assets(const assets&) = delete;
+
+        /**
+         * @brief Cancel pending loads and wait for decodes in progress.
+         */
+        ~assets();
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        assets& operator=(const assets&) = delete;
+
         /**
          * @brief Add asset loader to the registry.
-         * 
+         *
          * @tparam Asset Type of asset for loading.
          * @tparam Loader Type of loader. Must override calling operator.
          * @tparam Args Types of arguments to construct a new loader.
-         * 
+         *
          * @param args Arguments to construct a new loader.
          */
         template<typename Asset, typename Loader, typename... Args>
         void loader(Args&&... args) {
-            m_loaders.emplace(type_hash<Asset>(), [loader = std::make_shared<Loader>(std::forward<Args>(args)...)](std::string_view path) {
-                return ref<Asset>((*loader)(path));
-            });
+            auto loader = std::make_shared<Loader>(std::forward<Args>(args)...);
+
+            asset_type& entry = type(type_index<Asset>::value());
+            if (entry.decode) {
+                return;
+            }
+
+            entry.split = is_async_loader<Loader>::value;
+            m_report.name(type_index<Asset>::value(), type_id<Asset>().name());
+
+            entry.size = [](const reference& asset) -> std::size_t {
+                if constexpr (has_memory_size<Asset>::value) {
+                    return static_cast<const Asset&>(asset).memory_size();
+                } else {
+                    return 0;
+                }
+            };
+
+            if constexpr (is_async_loader<Loader>::value) {
+                entry.decode = [loader](std::string_view path) -> std::function<ref<reference>()> {
+                    // std::function must be copyable, so decoded data is shared.
+                    auto decoded = std::make_shared<decltype(loader->decode(path))>(loader->decode(path));
+
+                    return [loader, decoded] {
+                        return ref<reference>(ref<Asset>(loader->finish(std::move(*decoded))));
+                    };
+                };
+            } else {
+                entry.decode = [loader](std::string_view path) -> std::function<ref<reference>()> {
+                    return [loader, path = std::string(path)] {
+                        return ref<reference>(ref<Asset>((*loader)(path)));
+                    };
+                };
+            }
         }
 
         /**
          * @brief Load a new asset. If asset is already loaded, returns that asset without loading.
-         * 
+         *
          * @tparam Asset Type of asset to load.
-         * 
-         * @param path Path to the asset.
-         * 
+         *
+         * @param id Identifier of the asset.
+         *
          * @return Loaded reference to asset.
          */
         template<typename Asset>
-        ref<Asset> load(std::string_view path) {
-            auto& loaded_asset = m_assets[std::string(path)];
-            if (loaded_asset) {
-                return ref<Asset>((Asset*)loaded_asset.get());
+        ref<Asset> load(const asset_id& id) {
+            const id_type index = type_index<Asset>::value();
+
+            if (reference* loaded_asset = find(id, index); loaded_asset) {
+                m_report.hit(index);
+                return ref<Asset>((Asset*)loaded_asset);
             }
 
-            auto& loader = m_loaders.at(type_hash<Asset>());
-            ref<Asset> new_asset = (Asset*)loader(path).get();
-            loaded_asset = new_asset;
-            return new_asset;
+            assert(index < m_types.size() && m_types[index].decode && "Asset loader is not registered");
+            return ref<Asset>((Asset*)load(id, index).get());
+        }
+
+        /**
+         * @brief Load an asset asynchronously. If asset is already loaded, returns ready request.
+         *        Requests for an asset that is already being loaded share the same request.
+         *
+         * @tparam Asset Type of asset to load.
+         *
+         * @param id Identifier of the asset.
+         *
+         * @return Request to poll for the loaded asset.
+         */
+        template<typename Asset>
+        ref<asset_future<Asset>> load_async(const asset_id& id) {
+            const id_type index = type_index<Asset>::value();
+
+            // Pending loads are keyed by type too, so the shared request has the requested type.
+            if (auto pending = m_pending.find(key(id, index)); pending != m_pending.end()) {
+                assert(pending->second->path() == id.path() && "Asset path hash collision");
+                m_report.join(index);
+                return ref<asset_future<Asset>>(static_cast<asset_future<Asset>*>(pending->second.get()));
+            }
+
+            ref<asset_future<Asset>> request(new asset_future<Asset>(id.path()));
+
+            if (reference* loaded_asset = find(id, index); loaded_asset) {
+                m_report.hit(index);
+                complete(*request, loaded_asset);
+                return request;
+            }
+
+            assert(index < m_types.size() && m_types[index].decode && "Asset loader is not registered");
+
+            m_pending.emplace(key(id, index), request);
+            decode(request, m_types[index].decode);
+            return request;
+        }
+
+        /**
+         * @brief Finish decoded asynchronous loads on the calling (main) thread.
+         *        Stops once time budget is exceeded, remaining loads are finished by next calls.
+         *        Call once per frame.
+         *
+         * @param time_budget Time budget in seconds.
+         */
+        void dispatch(float time_budget = 0.002f);
+
+        /**
+         * @brief Get number of asynchronous loads that did not finish yet.
+         *
+         * @return Number of pending loads.
+         */
+        [[nodiscard]] std::size_t pending() const;
+
+        /**
+         * @brief Intern a path built at runtime. Returned identifier stays valid
+         *        as long as the assets manager, so it can be stored and reused.
+         *
+         * @param path Path to the asset.
+         *
+         * @return Identifier of the asset.
+         */
+        [[nodiscard]] asset_id intern(std::string_view path);
+
+        /**
+         * @brief Limit memory used by loaded assets of given type.
+         *
+         * @tparam Asset Type of assets.
+         *
+         * @param budget Budget in bytes.
+         */
+        template<typename Asset>
+        void set_budget(std::size_t budget) {
+            type(type_index<Asset>::value()).budget = budget;
+            trim();
+        }
+
+        /**
+         * @brief Get memory used by loaded assets of given type.
+         *
+         * @tparam Asset Type of assets.
+         *
+         * @return Used memory in bytes.
+         */
+        template<typename Asset>
+        [[nodiscard]] std::size_t memory_usage() const {
+            const id_type index = type_index<Asset>::value();
+            return index < m_types.size() ? m_types[index].used : 0;
+        }
+
+        /**
+         * @brief Evict least recently used assets referenced only by the cache
+         *        from asset types that exceed their budget. Called by dispatch,
+         *        call manually when assets are loaded only synchronously.
+         */
+        void trim();
+
+        /**
+         * @brief Get metrics of loaded assets.
+         *
+         * @return Report of loaded assets.
+         */
+        [[nodiscard]] asset_report& report() {
+            return m_report;
+        }
+
+        /**
+         * @brief Get metrics of loaded assets.
+         *
+         * @return Report of loaded assets.
+         */
+        [[nodiscard]] const asset_report& report() const {
+            return m_report;
         }
 
     private:
         /**
-         * @brief Registered loaders.
+         * @brief Function decoding an asset and returning function that finishes it.
+         */
+        using decode_function = std::function<std::function<ref<reference>()>(std::string_view)>;
+
+        struct cached_asset;
+
+        /**
+         * @brief Loaded asset with its key.
+         */
+        using cache_entry = std::pair<const std::uint64_t, cached_asset>;
+
+        /**
+         * @brief Loaded asset.
+         */
+        struct cached_asset {
+            /**
+             * @brief Reference held by the cache.
+             */
+            ref<reference> asset;
+
+            /**
+             * @brief Path to the asset.
+             */
+            std::string path;
+
+            /**
+             * @brief Index of the asset type.
+             */
+            id_type type;
+
+            /**
+             * @brief Memory used by the asset.
+             */
+            std::size_t size;
+
+            /**
+             * @brief Position in least recently used list of the type.
+             */
+            std::list<cache_entry*>::iterator position;
+        };
+
+        /**
+         * @brief Type-erased loader and loaded assets of a single type.
+         */
+        struct asset_type {
+            /**
+             * @brief Decode asset on any thread.
+             */
+            decode_function decode;
+
+            /**
+             * @brief Get memory used by an asset.
+             */
+            std::size_t (*size)(const reference&) = nullptr;
+
+            /**
+             * @brief Tell whether loader decodes and finishes in separate phases.
+             *        Finishing a loader that does not is measured as decoding.
+             */
+            bool split = false;
+
+            /**
+             * @brief Memory budget in bytes.
+             */
+            std::size_t budget = std::numeric_limits<std::size_t>::max();
+
+            /**
+             * @brief Memory used by loaded assets.
+             */
+            std::size_t used = 0;
+
+            /**
+             * @brief Loaded assets, most recently used first.
+             */
+            std::list<cache_entry*> order;
+        };
+
+        /**
+         * @brief Tell whether loader splits loading into decode and finish phases.
+         */
+        template<typename Loader, typename = void>
+        struct is_async_loader : std::false_type {};
+
+        template<typename Loader>
+        struct is_async_loader<Loader, std::void_t<decltype(std::declval<const Loader&>().finish(std::declval<const Loader&>().decode(std::string_view())))>> : std::true_type {};
+
+        /**
+         * @brief Tell whether asset reports its memory usage.
+         */
+        template<typename Asset, typename = void>
+        struct has_memory_size : std::false_type {};
+
+        template<typename Asset>
+        struct has_memory_size<Asset, std::void_t<decltype(std::declval<const Asset&>().memory_size())>> : std::true_type {};
+
+        /**
+         * @brief Get asset type, registering it if needed.
+         *
+         * @param index Index of the asset type.
+         *
+         * @return Asset type.
+         */
+        asset_type& type(id_type index);
+
+        /**
+         * @brief Load asset synchronously and add it to the cache.
+         *
+         * @param id Identifier of the asset.
+         * @param type Index of the asset type.
+         *
+         * @return Loaded asset or null if loading failed.
+         */
+        ref<reference> load(const asset_id& id, id_type type);
+
+        /**
+         * @brief Get key of an asset in the cache and pending loads.
+         *        The same path can be loaded as assets of different types.
+         *
+         * @param id Identifier of the asset.
+         * @param type Index of the asset type.
+         *
+         * @return Key of the asset.
+         */
+        [[nodiscard]] static std::uint64_t key(const asset_id& id, id_type type) {
+            return id.value() ^ (std::uint64_t(type) * 0x9e3779b97f4a7c15ull);
+        }
+
+        /**
+         * @brief Find loaded asset and mark it as recently used.
+         *
+         * @param id Identifier of the asset.
+         * @param type Index of the asset type.
+         *
+         * @return Loaded asset or null if not loaded.
+         */
+        reference* find(const asset_id& id, id_type type);
+
+        /**
+         * @brief Add loaded asset to the cache and evict assets over budget.
+         *        If the asset is cached already, the cached one is kept.
+         *
+         * @param id Identifier of the asset.
+         * @param type Index of the asset type.
+         * @param asset Loaded asset.
+         *
+         * @return Cached asset.
+         */
+        ref<reference> insert(const asset_id& id, id_type type, ref<reference> asset);
+
+        /**
+         * @brief Evict assets of a single type until it fits its budget.
+         *
+         * @param type Asset type.
+         */
+        void trim(asset_type& type);
+
+        /**
+         * @brief Decode asset on the thread pool and queue it for finishing.
+         *
+         * @param request Pending request.
+         * @param decode Function decoding the asset.
+         */
+        void decode(ref<asset_request> request, decode_function decode);
+
+        /**
+         * @brief Mark request as completed with loaded asset.
+         *
+         * @param request Request to complete.
+         * @param asset Loaded asset or null on failure.
+         */
+        static void complete(asset_request& request, ref<reference> asset);
+
+        /**
+         * @brief Asset types indexed by type index.
+         */
+        std::vector<asset_type> m_types;
+
+        /**
+         * @brief Loaded assets by key.
+         */
+        std::unordered_map<std::uint64_t, cached_asset> m_assets;
+
+        /**
+         * @brief Asynchronous loads that did not finish yet by key.
+         */
+        std::unordered_map<std::uint64_t, ref<asset_request>> m_pending;
+
+        /**
+         * @brief Interned paths by hash.
+         */
+        std::unordered_map<std::uint64_t, std::string> m_interned;
+
+        /**
+         * @brief Thread pool decoding asynchronous loads.
+         */
+        thread_pool* m_pool = nullptr;
+
+        /**
+         * @brief Counter of decodes in progress.
+         */
+        task_counter m_decoding;
+
+        /**
+         * @brief Mutex guarding decoded requests.
+         */
+        mutable std::mutex m_mutex;
+
+        /**
+         * @brief Requests decoded and waiting for finishing on the main thread.
          */
-        std::map<id_type, std::function<ref<reference>(std::string_view)>> m_loaders;
+        std::deque<ref<asset_request>> m_decoded;
 
         /**
-         * @brief Loaded assets.
+         * @brief Metrics of loaded assets.
          */
-        std::unordered_map<std::string, ref<reference>> m_assets;
+        asset_report m_report;
     };
 }
@@ -2,33 +2,150 @@
 
 #include "span.hpp"
 
+#include <iosfwd>
+#include <memory>
 #include <cstdint>
 #include <vector>
+#include <functional>
 
 namespace rb {
+    class thread_pool;
+
+    /**
+     * @brief Trade-off between compression speed and ratio.
+     */
+    enum class compression_level {
+        /**
+         * @brief Fastest compression, lowest ratio.
+         */
+        fastest,
+
+        /**
+         * @brief Balance between speed and ratio.
+         */
+        balanced,
+
+        /**
+         * @brief Highest ratio, slowest compression.
+         */
+        best
+    };
+
     /**
      * @brief Lossless, high performance data compressor.
+     *
+     *        Compressor owns compression and decompression state and a scratch buffer that are reused
+     *        between calls, so compressing into caller-provided buffers does not allocate in steady state.
+     *        Because of that a single compressor must not be used by multiple threads at the same time.
      */
     class compressor {
     public:
+		/**
+		 * @brief Function reading next chunk of input into the buffer.
+		 *        Returns number of bytes read, zero at the end of input.
+		 */
+		using read_callback = std::function<std::size_t(void* data, std::size_t size)>;
+
+		/**
+		 * @brief Function consuming next chunk of output.
+		 *        Returns false to abort the stream.
+		 */
+		using write_callback = std::function<bool(const void* data, std::size_t size)>;
+
+		/**
+		 * @brief Size of chunks read and written by streaming functions.
+		 */
+		static constexpr std::size_t stream_chunk_size = 64 * 1024;
+
+		/**
+		 * @brief Default size of independently compressed blocks.
+		 */
+		static constexpr std::size_t default_block_size = 256 * 1024;
+
+		/**
+		 * @brief Maximum size of a preset dictionary. Deflate cannot reference data further back.
+		 */
+		static constexpr std::size_t max_dictionary_size = 32 * 1024;
+
+		/**
+		 * @brief Construct a new compressor.
+		 *
+		 * @param level Compression level.
+		 */
+		compressor(compression_level level = compression_level::fastest);
+
+		/**
+		 * @brief Disabled copy constructor.
+		 */
+		compressor(const compressor&) = delete;
+
+		/**
+		 * @brief Enabled move constructor.
+		 */
+		compressor(compressor&&) noexcept;
+
+		/**
+		 * @brief Destruct the compressor.
+		 */
+		~compressor();
+
+		/**
+		 * @brief Disabled copy assignment.
+		 */
+		compressor& operator=(const compressor&) = delete;
+
+		/**
+		 * @brief Enabled move assignment.
+		 */
+		compressor& operator=(compressor&&) noexcept;
+
+		/**
+		 * @brief Set compression level used by subsequent calls.
+		 *
+		 * @param level Compression level.
+		 */
+		void set_level(compression_level level);
+
+		/**
+		 * @brief Get compression level.
+		 *
+		 * @return Compression level.
+		 */
+		[[nodiscard]] compression_level level() const;
+
 		[[nodiscard]] std::size_t bound(std::size_t uncompressed_size) const;
 
         std::size_t compress(const void* uncompressed_data, std::size_t uncompressed_size, void* compressed_data, std::size_t compressed_bound) const;
 
         std::size_t uncompress(const void* compressed_data, std::size_t compressed_size, void* uncompressed_data, std::size_t uncompressed_size) const;
+
+		/**
+		 * @brief Compress data into a growable buffer. Buffer capacity is kept
+		 *        between calls, so reusing the same buffer does not allocate in steady state.
+		 *
+		 * @param uncompressed_data Data to compress.
+		 * @param compressed_data Buffer resized to the compressed size.
+		 *
+		 * @return Number of compressed bytes or zero on failure.
+		 */
+		std::size_t compress(span<const std::uint8_t> uncompressed_data, std::vector<std::uint8_t>& compressed_data) const;
+
+		/**
+		 * @brief Uncompress data into a growable buffer. Buffer capacity is kept
+		 *        between calls, so reusing the same buffer does not allocate in steady state.
+		 *
+		 * @param compressed_data Data to uncompress.
+		 * @param uncompressed_size Size of uncompressed data.
+		 * @param uncompressed_data Buffer resized to the uncompressed size.
+		 *
+		 * @return Number of uncompressed bytes or zero on failure.
+		 */
+		std::size_t uncompress(span<const std::uint8_t> compressed_data, std::size_t uncompressed_size, std::vector<std::uint8_t>& uncompressed_data) const;
     
 		template<typename T>
 		[[nodiscard]] std::vector<std::uint8_t> compress(span<const T> uncompressed_data) const {
-			std::vector<std::uint8_t> compressed_data(bound(uncompressed_data.size_bytes()));
-			std::size_t compressed_size = compress(uncompressed_data.data(), uncompressed_data.size_bytes(), compressed_data.data(), compressed_data.size());
-			
-			if (compressed_size > 0) {
-				compressed_data.resize(compressed_size);
-				compressed_data.shrink_to_fit();
-				return compressed_data;
-			}
-
-			return {};
+			const span<const std::uint8_t> compressed_data = compress_to_scratch(uncompressed_data.data(), uncompressed_data.size_bytes());
+			return { compressed_data.begin(), compressed_data.end() };
 		}
 
 		template<typename T = std::uint8_t>
@@ -37,5 +154,186 @@ namespace rb {
 			std::size_t size = uncompress(compressed_data.data(), compressed_data.size_bytes(), uncompressed_data.data(), uncompressed_size);
 			return size > 0 ? uncompressed_data : std::vector<T>{};
 		}
+
+		/**
+		 * @brief Compress data incrementally. Input is read and output is written in chunks,
+		 *        so memory usage does not depend on data size. Output is compatible with uncompress.
+		 *
+		 * @param read Function providing uncompressed data.
+		 * @param write Function consuming compressed data.
+		 *
+		 * @return Number of compressed bytes written or zero on failure.
+		 */
+		std::size_t compress_stream(const read_callback& read, const write_callback& write) const;
+
+		/**
+		 * @brief Uncompress data incrementally. Input is read and output is written in chunks,
+		 *        so memory usage does not depend on data size. Accepts output of compress.
+		 *
+		 * @param read Function providing compressed data.
+		 * @param write Function consuming uncompressed data.
+		 *
+		 * @return Number of uncompressed bytes written or zero on failure.
+		 */
+		std::size_t uncompress_stream(const read_callback& read, const write_callback& write) const;
+
+		/**
+		 * @brief Compress data from input stream to output stream in chunks.
+		 *
+		 * @param input Stream of uncompressed data.
+		 * @param output Stream of compressed data.
+		 *
+		 * @return Number of compressed bytes written or zero on failure.
+		 */
+		std::size_t compress_stream(std::istream& input, std::ostream& output) const;
+
+		/**
+		 * @brief Uncompress data from input stream to output stream in chunks.
+		 *
+		 * @param input Stream of compressed data.
+		 * @param output Stream of uncompressed data.
+		 *
+		 * @return Number of uncompressed bytes written or zero on failure.
+		 */
+		std::size_t uncompress_stream(std::istream& input, std::ostream& output) const;
+
+		/**
+		 * @brief Compress data as independent blocks concurrently on the thread pool.
+		 *        Output starts with a header and a block index, so blocks can be
+		 *        uncompressed in parallel or individually. Blocks that do not shrink are stored as is.
+		 *
+		 * @param pool Thread pool to compress on.
+		 * @param uncompressed_data Data to compress.
+		 * @param block_size Size of uncompressed blocks in bytes.
+		 *
+		 * @return Compressed blocks or empty vector on failure.
+		 */
+		[[nodiscard]] std::vector<std::uint8_t> compress_blocks(thread_pool& pool, span<const std::uint8_t> uncompressed_data, std::size_t block_size = default_block_size) const;
+
+		/**
+		 * @brief Uncompress all blocks concurrently on the thread pool.
+		 *
+		 * @param pool Thread pool to uncompress on.
+		 * @param compressed_data Output of compress_blocks.
+		 * @param uncompressed_data Buffer of at least blocks_uncompressed_size bytes.
+		 * @param uncompressed_size Size of the buffer.
+		 *
+		 * @return Number of uncompressed bytes or zero on failure.
+		 */
+		std::size_t uncompress_blocks(thread_pool& pool, span<const std::uint8_t> compressed_data, void* uncompressed_data, std::size_t uncompressed_size) const;
+
+		/**
+		 * @brief Uncompress a single block.
+		 *
+		 * @param compressed_data Output of compress_blocks.
+		 * @param index Index of the block.
+		 * @param uncompressed_data Buffer of at least block size bytes.
+		 * @param uncompressed_size Size of the buffer.
+		 *
+		 * @return Number of uncompressed bytes or zero on failure.
+		 */
+		std::size_t uncompress_block(span<const std::uint8_t> compressed_data, std::size_t index, void* uncompressed_data, std::size_t uncompressed_size) const;
+
+		/**
+		 * @brief Get total uncompressed size of compressed blocks.
+		 *
+		 * @param compressed_data Output of compress_blocks.
+		 *
+		 * @return Uncompressed size or zero if data is not valid.
+		 */
+		[[nodiscard]] std::size_t blocks_uncompressed_size(span<const std::uint8_t> compressed_data) const;
+
+		/**
+		 * @brief Get uncompressed size of a single block.
+		 *
+		 * @param compressed_data Output of compress_blocks.
+		 *
+		 * @return Block size or zero if data is not valid.
+		 */
+		[[nodiscard]] std::size_t block_size(span<const std::uint8_t> compressed_data) const;
+
+		/**
+		 * @brief Get number of compressed blocks.
+		 *
+		 * @param compressed_data Output of compress_blocks.
+		 *
+		 * @return Number of blocks or zero if data is not valid.
+		 */
+		[[nodiscard]] std::size_t block_count(span<const std::uint8_t> compressed_data) const;
+
+		/**
+		 * @brief Register a preset dictionary. Small payloads similar to the dictionary
+		 *        compress much better, because deflate can reference dictionary content.
+		 *        Only the last max_dictionary_size bytes are used.
+		 *
+		 * @param id Identifier to select the dictionary with.
+		 * @param dictionary Dictionary content, e.g. produced by train_dictionary.
+		 */
+		void add_dictionary(std::uint32_t id, span<const std::uint8_t> dictionary);
+
+		/**
+		 * @brief Unregister a preset dictionary.
+		 *
+		 * @param id Identifier of the dictionary.
+		 */
+		void remove_dictionary(std::uint32_t id);
+
+		/**
+		 * @brief Compress data against a preset dictionary into raw deflate stream.
+		 *        Output can be uncompressed only with the same dictionary.
+		 *
+		 * @param dictionary_id Identifier of a registered dictionary.
+		 * @param uncompressed_data Data to compress.
+		 * @param uncompressed_size Size of data to compress.
+		 * @param compressed_data Output buffer.
+		 * @param compressed_bound Size of the output buffer, bound(uncompressed_size) is always enough.
+		 *
+		 * @return Number of compressed bytes or zero on failure or unknown dictionary.
+		 */
+		std::size_t compress(std::uint32_t dictionary_id, const void* uncompressed_data, std::size_t uncompressed_size, void* compressed_data, std::size_t compressed_bound) const;
+
+		/**
+		 * @brief Uncompress data compressed against a preset dictionary.
+		 *
+		 * @param dictionary_id Identifier of a registered dictionary.
+		 * @param compressed_data Data to uncompress.
+		 * @param compressed_size Size of data to uncompress.
+		 * @param uncompressed_data Output buffer.
+		 * @param uncompressed_size Size of uncompressed data.
+		 *
+		 * @return Number of uncompressed bytes or zero on failure or unknown dictionary.
+		 */
+		std::size_t uncompress(std::uint32_t dictionary_id, const void* compressed_data, std::size_t compressed_size, void* uncompressed_data, std::size_t uncompressed_size) const;
+
+		/**
+		 * @brief Build a preset dictionary from sample payloads. Picks segments made of substrings
+		 *        shared by most samples, the most common ones are placed at the end of the dictionary
+		 *        where they are cheapest to reference.
+		 *
+		 * @param samples Sample payloads, e.g. captured network messages.
+		 * @param capacity Maximum size of the dictionary.
+		 * @param segment_size Size of segments copied from samples.
+		 *
+		 * @return Dictionary content, empty if samples have nothing in common.
+		 */
+		[[nodiscard]] static std::vector<std::uint8_t> train_dictionary(span<const std::vector<std::uint8_t>> samples, std::size_t capacity = max_dictionary_size, std::size_t segment_size = 64);
+
+	private:
+		/**
+		 * @brief Compress data into the internal scratch buffer.
+		 *
+		 * @return View of compressed data valid until next call or empty view on failure.
+		 */
+		span<const std::uint8_t> compress_to_scratch(const void* uncompressed_data, std::size_t uncompressed_size) const;
+
+		/**
+		 * @brief Implementation specific data structure.
+		 */
+		struct data;
+
+		/**
+		 * @brief Implementation specific data pointer.
+		 */
+		std::unique_ptr<data> m_data;
     };
 }
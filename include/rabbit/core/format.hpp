@@ -8,7 +8,7 @@ namespace rb {
     using fmt::vprint;
 
     template<typename... Args>
-    void println(Args&&... args) {
-        print("{}\n", format(std::forward<Args>(args)...));
+    void println(fmt::format_string<Args...> format_string, Args&&... args) {
+        print("{}\n", format(format_string, std::forward<Args>(args)...));
     }
 }
@@ -11,6 +11,37 @@ namespace rb {
      * @brief Multi-purpose object handle.
      *        Mainly used for communication with data-oriented services.
      *        (e.g. Renderer or Physics).
+     *
+     *        Lower bits of the handle store a slot index and upper bits
+     *        store a generation (version) of the slot, so a recycled handle
+     *        can be told apart from a stale one.
      */
     enum class handle : id_type {};
+
+    /**
+     * @brief Index/version bit layout of the handle.
+     */
+    using handle_traits = entt::entt_traits<handle>;
+
+    /**
+     * @brief Get slot index stored in the handle.
+     *
+     * @param id Handle to decompose.
+     *
+     * @return Slot index of the handle.
+     */
+    [[nodiscard]] constexpr handle_traits::entity_type handle_index(handle id) noexcept {
+        return handle_traits::to_entity(id);
+    }
+
+    /**
+     * @brief Get generation stored in the handle.
+     *
+     * @param id Handle to decompose.
+     *
+     * @return Generation of the handle.
+     */
+    [[nodiscard]] constexpr handle_traits::version_type handle_version(handle id) noexcept {
+        return handle_traits::to_version(id);
+    }
 }
@@ -0,0 +1,155 @@
+#pragma once 
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+namespace rb {
+    /**
+     * @brief Memory usage statistics of an object pool.
+     */
+    struct object_pool_stats {
+        /**
+         * @brief Number of allocated objects.
+         */
+        std::size_t live = 0;
+
+        /**
+         * @brief Highest number of objects allocated at the same time.
+         */
+        std::size_t peak = 0;
+
+        /**
+         * @brief Number of object slots reserved by the pool.
+         */
+        std::size_t capacity = 0;
+    };
+
+    /**
+     * @brief Thread-safe free-list allocator of uninitialized memory for objects of a single type.
+     *        Memory is reserved in pages and recycled, so allocation waves do not reach the heap
+     *        once the pool grew to the peak size. Pages are kept until the program exits.
+     *
+     * @tparam T Type of objects.
+     * @tparam PageSize Number of objects per page.
+     */
+    template<typename T, std::size_t PageSize = 64>
+    class object_pool {
+    public:
+        /**
+         * @brief Construct an empty pool.
+         */
+        object_pool() = default;
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        object_pool(const object_pool&) = delete;
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        object_pool& operator=(const object_pool&) = delete;
+
+        /**
+         * @brief Get pool shared by all objects of type T.
+         *        Never destroyed, so objects can be released during static destruction.
+         *
+         * @return Shared pool.
+         */
+        [[nodiscard]] static object_pool& instance() {
+            static object_pool* pool = new object_pool();
+            return *pool;
+        }
+
+        /**
+         * @brief Allocate memory for a single object.
+         *
+         * @return Uninitialized memory.
+         */
+        [[nodiscard]] void* allocate() {
+            std::lock_guard lock(m_mutex);
+
+            if (!m_free) {
+                grow();
+            }
+
+            node* block = m_free;
+            m_free = block->next;
+
+            m_stats.peak = std::max(++m_stats.live, m_stats.peak);
+            return block;
+        }
+
+        /**
+         * @brief Return memory of a destroyed object to the pool.
+         *
+         * @param pointer Memory returned by allocate.
+         */
+        void deallocate(void* pointer) {
+            std::lock_guard lock(m_mutex);
+
+            m_free = ::new (pointer) node{ m_free };
+            --m_stats.live;
+        }
+
+        /**
+         * @brief Get memory usage statistics.
+         *
+         * @return Pool statistics.
+         */
+        [[nodiscard]] object_pool_stats stats() const {
+            std::lock_guard lock(m_mutex);
+            return m_stats;
+        }
+
+    private:
+        /**
+         * @brief Free slot, links to the next free slot.
+         */
+        struct node {
+            node* next;
+        };
+
+        /**
+         * @brief Storage of a single slot big enough for both object and free list node.
+         */
+        using storage_type = std::aligned_storage_t<std::max(sizeof(T), sizeof(node)), std::max(alignof(T), alignof(node))>;
+
+        /**
+         * @brief Reserve a new page and link its slots into the free list.
+         */
+        void grow() {
+            storage_type* page = m_pages.emplace_back(std::make_unique<storage_type[]>(PageSize)).get();
+
+            for (std::size_t i = PageSize; i > 0; --i) {
+                m_free = ::new (static_cast<void*>(&page[i - 1])) node{ m_free };
+            }
+
+            m_stats.capacity += PageSize;
+        }
+
+        /**
+         * @brief Mutex guarding pool state.
+         */
+        mutable std::mutex m_mutex;
+
+        /**
+         * @brief Reserved pages.
+         */
+        std::vector<std::unique_ptr<storage_type[]>> m_pages;
+
+        /**
+         * @brief First free slot.
+         */
+        node* m_free = nullptr;
+
+        /**
+         * @brief Memory usage statistics.
+         */
+        object_pool_stats m_stats;
+    };
+}
@@ -0,0 +1,230 @@
+#pragma once 
+
+#include "span.hpp"
+#include "compressor.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+namespace rb {
+    /**
+     * @brief Read-only content of a file. Either points directly into a memory-mapped
+     *        pack or owns the bytes when the file had to be read or uncompressed.
+     */
+    class file_view {
+    public:
+        /**
+         * @brief Construct an empty view.
+         */
+        file_view() = default;
+
+        /**
+         * @brief Construct a view of memory owned by somebody else.
+         *
+         * @param data Viewed bytes.
+         */
+        explicit file_view(span<const std::uint8_t> data);
+
+        /**
+         * @brief Construct a view owning its bytes.
+         *
+         * @param data Owned bytes.
+         */
+        explicit file_view(std::vector<std::uint8_t> data);
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        file_view(const file_view&) = delete;
+
+        /**
+         * @brief Enabled move constructor.
+         */
+        file_view(file_view&&) noexcept = default;
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        file_view& operator=(const file_view&) = delete;
+
+        /**
+         * @brief Enabled move assignment.
+         */
+        file_view& operator=(file_view&&) noexcept = default;
+
+        /**
+         * @brief Get file content.
+         *
+         * @return File content.
+         */
+        [[nodiscard]] span<const std::uint8_t> bytes() const;
+
+        /**
+         * @brief Tell whether the view is empty.
+         *
+         * @return True if empty, false otherwise.
+         */
+        [[nodiscard]] bool empty() const;
+
+    private:
+        /**
+         * @brief Viewed bytes.
+         */
+        span<const std::uint8_t> m_data;
+
+        /**
+         * @brief Owned bytes, empty if view points into a mapping.
+         */
+        std::vector<std::uint8_t> m_storage;
+    };
+
+    /**
+     * @brief Read-only archive of asset files, memory-mapped as a whole.
+     *
+     *        Table of contents is sorted by path hash, so lookups are a binary search without
+     *        touching the disk. Entries start at 4 KB boundaries. Entries stored uncompressed
+     *        are viewed directly in the mapping, compressed entries are uncompressed on open.
+     *        Pack can be used by multiple threads at the same time.
+     */
+    class pack {
+    public:
+        /**
+         * @brief Alignment of entries in the archive.
+         */
+        static constexpr std::size_t entry_alignment = 4096;
+
+        /**
+         * @brief Construct a closed pack.
+         */
+        pack();
+
+        /**
+         * @brief Map pack archive from file.
+         *
+         * @param path Path to the archive.
+         */
+        explicit pack(std::string_view path);
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        pack(const pack&) = delete;
+
+        /**
+         * @brief Enabled move constructor.
+         */
+        pack(pack&&) noexcept;
+
+        /**
+         * @brief Unmap the archive.
+         */
+        ~pack();
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        pack& operator=(const pack&) = delete;
+
+        /**
+         * @brief Enabled move assignment.
+         */
+        pack& operator=(pack&&) noexcept;
+
+        /**
+         * @brief Tell whether a valid archive has been mapped.
+         *
+         * @return True if mapped, false otherwise.
+         */
+        [[nodiscard]] bool is_open() const;
+
+        /**
+         * @brief Get number of files in the archive.
+         *
+         * @return Number of files.
+         */
+        [[nodiscard]] std::size_t size() const;
+
+        /**
+         * @brief Tell whether the archive contains a file.
+         *
+         * @param path Path of the file.
+         *
+         * @return True if the file is in the archive, false otherwise.
+         */
+        [[nodiscard]] bool contains(std::string_view path) const;
+
+        /**
+         * @brief Open a file in the archive.
+         *
+         * @param path Path of the file.
+         *
+         * @return File content or empty view if not found.
+         */
+        [[nodiscard]] file_view open(std::string_view path) const;
+
+    private:
+        /**
+         * @brief Private implementation.
+         */
+        struct data;
+
+        /**
+         * @brief Private implementation.
+         */
+        std::unique_ptr<data> m_data;
+    };
+
+    /**
+     * @brief Builder of pack archives.
+     */
+    class pack_writer {
+    public:
+        /**
+         * @brief Add file to the archive. File with the same path is replaced.
+         *
+         * @param path Path the file is opened with.
+         * @param data File content.
+         * @param compress Tell whether the file should be compressed. File is stored
+         *                 uncompressed anyway if compression does not shrink it.
+         */
+        void add(std::string_view path, std::vector<std::uint8_t> data, bool compress = true);
+
+        /**
+         * @brief Write the archive to file.
+         *
+         * @param path Path to the archive.
+         * @param level Compression level of compressed files.
+         *
+         * @return True if written, false otherwise.
+         */
+        bool save(std::string_view path, compression_level level = compression_level::balanced) const;
+
+    private:
+        /**
+         * @brief File to write.
+         */
+        struct entry {
+            std::string path;
+            std::vector<std::uint8_t> data;
+            bool compress;
+        };
+
+        /**
+         * @brief Files to write.
+         */
+        std::vector<entry> m_entries;
+    };
+
+    /**
+     * @brief Open a file from the pack if it contains the file, from disk otherwise.
+     *
+     * @param pack Pack to look in or null.
+     * @param path Path of the file.
+     *
+     * @return File content.
+     */
+    [[nodiscard]] file_view open_file(const pack* pack, std::string_view path);
+}
@@ -0,0 +1,194 @@
+#pragma once 
+
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <iterator>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <type_traits>
+
+namespace rb {
+    /**
+     * @brief Pick grain size for a range so every thread gets several chunks to balance the load.
+     *
+     * @param pool Thread pool to run on.
+     * @param count Number of elements in the range.
+     *
+     * @return Number of elements per chunk.
+     */
+    [[nodiscard]] inline std::size_t parallel_grain(const thread_pool& pool, std::size_t count) {
+        return std::max<std::size_t>(count / ((std::size_t(pool.thread_count()) + 1) * 8), 1);
+    }
+
+    /**
+     * @brief Invoke function for every index in [begin, end) using the thread pool.
+     *        Chunks of grain size are claimed dynamically by workers and by the calling thread,
+     *        which helps executing them instead of blocking. Returns once all indices are processed.
+     *        First exception thrown by the function is rethrown on the calling thread.
+     *
+     * @param pool Thread pool to run on.
+     * @param begin First index.
+     * @param end Index one past the last.
+     * @param grain Number of indices per chunk. Zero picks grain size based on range and thread count.
+     * @param func Function invoked with each index.
+     */
+    template<typename Index, typename Func>
+    void parallel_for(thread_pool& pool, Index begin, Index end, std::size_t grain, Func&& func) {
+        static_assert(std::is_integral_v<Index>, "Index must be an integral type");
+
+        if (begin >= end) {
+            return;
+        }
+
+        const std::size_t count = std::size_t(end - begin);
+        const std::size_t chunk_size = grain > 0 ? grain : parallel_grain(pool, count);
+        const std::size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+        std::atomic<std::size_t> next_chunk = 0;
+        std::atomic<bool> failed = false;
+        std::exception_ptr exception;
+
+        auto process = [&] {
+            for (std::size_t chunk = next_chunk++; chunk < chunk_count && !failed.load(std::memory_order_relaxed); chunk = next_chunk++) {
+                const Index first = Index(begin + chunk * chunk_size);
+                const Index last = Index(std::min(std::size_t(first - begin) + chunk_size, count) + begin);
+
+                try {
+                    for (Index i = first; i < last; ++i) {
+                        std::invoke(func, i);
+                    }
+                } catch (...) {
+                    if (!failed.exchange(true)) {
+                        exception = std::current_exception();
+                    }
+                }
+            }
+        };
+
+        task_counter counter;
+
+        const std::size_t helper_count = std::min<std::size_t>(pool.thread_count(), chunk_count - 1);
+        for (std::size_t i = 0; i < helper_count; ++i) {
+            pool.submit_detached(counter, std::ref(process));
+        }
+
+        process();
+        pool.wait(counter);
+
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    /**
+     * @brief Invoke function for every index in [begin, end) using the thread pool
+     *        with grain size picked based on range and thread count.
+     *
+     * @param pool Thread pool to run on.
+     * @param begin First index.
+     * @param end Index one past the last.
+     * @param func Function invoked with each index.
+     */
+    template<typename Index, typename Func>
+    void parallel_for(thread_pool& pool, Index begin, Index end, Func&& func) {
+        parallel_for(pool, begin, end, 0, std::forward<Func>(func));
+    }
+
+    /**
+     * @brief Map every index in [begin, end) to a value and combine values using the thread pool.
+     *        Partial results are combined in index order, so the result is deterministic
+     *        for a given grain size even if reduction is not associative (e.g. floating point addition).
+     *
+     * @param pool Thread pool to run on.
+     * @param begin First index.
+     * @param end Index one past the last.
+     * @param grain Number of indices per chunk. Zero picks grain size based on range and thread count.
+     * @param identity Identity value of the reduction.
+     * @param map Function that maps index to a value.
+     * @param reduce Function that combines two values.
+     *
+     * @return Combined value or identity for empty range.
+     */
+    template<typename Index, typename T, typename Map, typename Reduce>
+    [[nodiscard]] T parallel_reduce(thread_pool& pool, Index begin, Index end, std::size_t grain, T identity, Map&& map, Reduce&& reduce) {
+        static_assert(std::is_integral_v<Index>, "Index must be an integral type");
+
+        if (begin >= end) {
+            return identity;
+        }
+
+        const std::size_t count = std::size_t(end - begin);
+        const std::size_t chunk_size = grain > 0 ? grain : parallel_grain(pool, count);
+        const std::size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+        std::vector<T> partials(chunk_count, identity);
+
+        parallel_for(pool, std::size_t(0), chunk_count, 1, [&](std::size_t chunk) {
+            const Index first = Index(begin + chunk * chunk_size);
+            const Index last = Index(std::min(std::size_t(first - begin) + chunk_size, count) + begin);
+
+            T value = identity;
+            for (Index i = first; i < last; ++i) {
+                value = std::invoke(reduce, std::move(value), std::invoke(map, i));
+            }
+
+            partials[chunk] = std::move(value);
+        });
+
+        T result = std::move(identity);
+        for (T& partial : partials) {
+            result = std::invoke(reduce, std::move(result), std::move(partial));
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Sort range using the thread pool. Blocks are sorted concurrently
+     *        and then merged pairwise in parallel rounds. Not stable.
+     *
+     * @param pool Thread pool to run on.
+     * @param first Beginning of the range.
+     * @param last End of the range.
+     * @param comp Comparison function object.
+     */
+    template<typename RandomIt, typename Compare = std::less<>>
+    void parallel_sort(thread_pool& pool, RandomIt first, RandomIt last, Compare comp = Compare()) {
+        // Below this size splitting costs more than it gains.
+        constexpr std::size_t min_block_size = 2048;
+
+        const std::size_t count = std::size_t(std::distance(first, last));
+        const std::size_t block_count = std::min<std::size_t>(std::size_t(pool.thread_count()) + 1, count / min_block_size);
+
+        if (block_count < 2) {
+            std::sort(first, last, comp);
+            return;
+        }
+
+        const std::size_t block_size = (count + block_count - 1) / block_count;
+
+        parallel_for(pool, std::size_t(0), block_count, 1, [&](std::size_t block) {
+            const std::size_t begin = block * block_size;
+            const std::size_t end = std::min(begin + block_size, count);
+            std::sort(first + begin, first + end, comp);
+        });
+
+        for (std::size_t width = block_size; width < count; width *= 2) {
+            const std::size_t pair_count = (count + width * 2 - 1) / (width * 2);
+
+            parallel_for(pool, std::size_t(0), pair_count, 1, [&](std::size_t pair) {
+                const std::size_t begin = pair * width * 2;
+                const std::size_t middle = std::min(begin + width, count);
+                const std::size_t end = std::min(begin + width * 2, count);
+
+                if (middle < end) {
+                    std::inplace_merge(first + begin, first + middle, first + end, comp);
+                }
+            });
+        }
+    }
+}
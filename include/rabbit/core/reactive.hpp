@@ -5,6 +5,7 @@
 namespace rb {
     using entt::delegate;
     using entt::sink;
+    using entt::connection;
     using entt::sigh;
     using entt::dispatcher;
 }
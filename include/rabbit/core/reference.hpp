@@ -1,15 +1,48 @@
 #pragma once 
 
+#include "object_pool.hpp"
+
 #include <atomic>
+#include <memory>
+#include <vector>
 #include <cstddef>
 #include <type_traits>
 
 namespace rb {
+    /**
+     * @brief Reference policy of objects shared between threads.
+     *        Counter is updated with atomic read-modify-write operations.
+     */
+    struct multi_threaded {};
+
+    /**
+     * @brief Reference policy of objects confined to a single thread.
+     *        Counter is updated with plain loads and stores, so copying
+     *        references does not lock the bus nor bounce the cache line.
+     *
+     *        Meant for objects owned by the main thread, such as GPU resources
+     *        and physics objects. References to them must not be copied
+     *        or released on other threads.
+     */
+    struct single_threaded {};
+
     /** 
      * @brief Base class for reference counting.
+     *
+     *        Derived classes select reference policy at compile time
+     *        by redeclaring the reference_policy type. Type-erased references
+     *        (e.g. ref<reference>) always use atomic operations.
      */
     class reference {
+        template<typename Ref>
+        friend class ref;
+
     public:
+        /**
+         * @brief Reference policy of the class.
+         */
+        using reference_policy = multi_threaded;
+
         /**
          * @brief Construct a new reference.
          */
@@ -40,11 +73,42 @@ namespace rb {
          */
         void release();
 
+        /**
+         * @brief Increment reference counter without atomic read-modify-write.
+         *
+         * @warning Object must be referenced from a single thread only.
+         */
+        void retain_local();
+
+        /**
+         * @brief Decrement reference counter without atomic read-modify-write.
+         *
+         * @warning Object must be referenced from a single thread only.
+         */
+        void release_local();
+
+        /**
+         * @brief Get number of references to the object.
+         *
+         * @return Reference counter.
+         */
+        [[nodiscard]] int use_count() const;
+
     private:
+        /**
+         * @brief Destroy the object and free its memory.
+         */
+        void destroy();
+
         /**
          * @brief Reference counter.
          */
         std::atomic<int> m_count = 0;
+
+        /**
+         * @brief Function destroying object allocated from a pool, null for objects allocated with new.
+         */
+        void (*m_deleter)(reference*) = nullptr;
     };
 
     /**
@@ -97,10 +161,11 @@ namespace rb {
 
         /**
          * @brief Construct reference wrapper with moved value.
+         *        Object is allocated from the pool of its type.
          *
          * @param value Value to initialize.
          */
-        ref(Ref&& value) : m_ptr(new Ref(std::forward<Ref>(value))) { retain(); }
+        ref(Ref&& value) : m_ptr(create(std::forward<Ref>(value))) { retain(); }
 
         /**
          * @brief Destruct a reference wrapper.
@@ -181,13 +246,72 @@ namespace rb {
          */
         [[nodiscard]] Ref* get() const { return m_ptr; }
 
+        /**
+         * @brief Give up ownership of the stored pointer without decrementing
+         *        reference counter and leave the wrapper empty.
+         *
+         * @return Stored pointer with one reference owned by the caller.
+         */
+        [[nodiscard]] Ref* detach() {
+            Ref* ptr = m_ptr;
+            m_ptr = nullptr;
+            return ptr;
+        }
+
+        /**
+         * @brief Get memory usage statistics of the pool objects created from values are allocated from.
+         *
+         * @return Pool statistics.
+         */
+        [[nodiscard]] static object_pool_stats pool_stats() {
+            return object_pool<Ref>::instance().stats();
+        }
+
     private:
+        /**
+         * @brief Move value into memory allocated from the pool of Ref.
+         *
+         * @param value Value to move.
+         *
+         * @return Pointer to the new object.
+         */
+        static Ref* create(Ref&& value) {
+            object_pool<Ref>& pool = object_pool<Ref>::instance();
+
+            void* memory = pool.allocate();
+
+            Ref* ptr = nullptr;
+            try {
+                ptr = ::new (memory) Ref(std::forward<Ref>(value));
+            } catch (...) {
+                pool.deallocate(memory);
+                throw;
+            }
+
+            static_cast<reference*>(ptr)->m_deleter = [](reference* ptr) {
+                Ref* object = static_cast<Ref*>(ptr);
+                std::destroy_at(object);
+                object_pool<Ref>::instance().deallocate(object);
+            };
+
+            return ptr;
+        }
+
+        /**
+         * @brief Tell whether counter of Ref can be updated without atomic operations.
+         */
+        static constexpr bool is_local = std::is_same_v<typename Ref::reference_policy, single_threaded>;
+
         /**
          * @brief Increment reference counter if ptr is exists.
          */
         void retain() {
             if (m_ptr) {
-                m_ptr->retain();
+                if constexpr (is_local) {
+                    m_ptr->retain_local();
+                } else {
+                    m_ptr->retain();
+                }
             }
         }
 
@@ -196,7 +320,11 @@ namespace rb {
          */
         void release() {
             if (m_ptr) {
-                m_ptr->release();
+                if constexpr (is_local) {
+                    m_ptr->release_local();
+                } else {
+                    m_ptr->release();
+                }
             }
         }
 
@@ -205,4 +333,73 @@ namespace rb {
          */
         Ref* m_ptr = nullptr;
     };
+
+    /**
+     * @brief Queue of references released together, e.g. once per frame after presenting,
+     *        so objects dropped during a frame are destroyed in one batch at a known point.
+     *        Pushing moves ownership into the queue without touching reference counters.
+     */
+    class release_queue {
+    public:
+        /**
+         * @brief Construct an empty queue.
+         */
+        release_queue() = default;
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        release_queue(const release_queue&) = delete;
+
+        /**
+         * @brief Enabled move constructor.
+         */
+        release_queue(release_queue&&) noexcept = default;
+
+        /**
+         * @brief Release all queued references.
+         */
+        ~release_queue();
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        release_queue& operator=(const release_queue&) = delete;
+
+        /**
+         * @brief Disabled move assignment.
+         */
+        release_queue& operator=(release_queue&&) = delete;
+
+        /**
+         * @brief Queue reference to release on next flush.
+         *
+         * @param value Reference wrapper to take ownership from.
+         */
+        template<typename Ref>
+        void push(ref<Ref>&& value) {
+            if (Ref* ptr = value.detach(); ptr) {
+                m_entries.push_back({ ptr, std::is_same_v<typename Ref::reference_policy, single_threaded> });
+            }
+        }
+
+        /**
+         * @brief Release all queued references. Objects whose counter drops to zero are destroyed.
+         */
+        void flush();
+
+    private:
+        /**
+         * @brief Queued reference with its policy.
+         */
+        struct entry {
+            reference* ptr;
+            bool local;
+        };
+
+        /**
+         * @brief Queued references. Capacity is kept between flushes.
+         */
+        std::vector<entry> m_entries;
+    };
 }
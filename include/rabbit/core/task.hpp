@@ -0,0 +1,476 @@
+#pragma once 
+
+#include "thread_pool.hpp"
+
+#include <new>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <exception>
+#include <string_view>
+
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#   include <coroutine>
+#   define RB_COROUTINES 1
+#endif
+
+namespace rb {
+    /**
+     * @brief Queue of callbacks executed by the thread owning the main loop.
+     *        Callbacks can be posted from any thread and run on next dispatch.
+     *        Storage is reused between frames, so posting does not allocate in steady state.
+     */
+    class frame_scheduler {
+    public:
+        /**
+         * @brief Type of posted callbacks.
+         */
+        using callback_type = void(*)(void*);
+
+        /**
+         * @brief Construct an empty scheduler.
+         */
+        frame_scheduler() = default;
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        frame_scheduler(const frame_scheduler&) = delete;
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        frame_scheduler& operator=(const frame_scheduler&) = delete;
+
+        /**
+         * @brief Post a callback to run on next dispatch. Thread-safe.
+         *
+         * @param callback Callback to run.
+         * @param context Argument passed to the callback.
+         */
+        void post(callback_type callback, void* context);
+
+        /**
+         * @brief Run callbacks posted before this call. Callbacks posted
+         *        while dispatching run on next dispatch. Call once per frame.
+         */
+        void dispatch();
+
+    private:
+        /**
+         * @brief Posted callback with its argument.
+         */
+        struct entry {
+            callback_type callback;
+            void* context;
+        };
+
+        /**
+         * @brief Mutex guarding posted callbacks.
+         */
+        std::mutex m_mutex;
+
+        /**
+         * @brief Callbacks to run on next dispatch.
+         */
+        std::vector<entry> m_posted;
+
+        /**
+         * @brief Callbacks being run by current dispatch.
+         */
+        std::vector<entry> m_running;
+    };
+
+    /**
+     * @brief Allocate memory for a coroutine frame. Frames are recycled through
+     *        per-thread free lists grouped by size, so spawning coroutines
+     *        does not allocate in steady state.
+     *
+     * @warning A frame goes back to the free list of the thread that destroys it.
+     *          Steady state is free of allocations only for coroutines created and
+     *          destroyed on the same thread. Coroutines finishing on pool workers
+     *          drain the list of the spawning thread and leave their frames cached
+     *          on the workers, up to the per-thread cache limit.
+     *
+     * @param size Size of the frame in bytes.
+     *
+     * @return Uninitialized memory.
+     */
+    [[nodiscard]] void* allocate_frame(std::size_t size);
+
+    /**
+     * @brief Return memory of a coroutine frame to the current thread free list,
+     *        which is not necessarily the list it has been allocated from.
+     *
+     * @param pointer Memory returned by allocate_frame.
+     * @param size Size passed to allocate_frame.
+     */
+    void deallocate_frame(void* pointer, std::size_t size);
+
+    /**
+     * @brief Read whole file into memory.
+     *
+     * @param path Path to the file.
+     *
+     * @return File content, empty if the file cannot be read.
+     */
+    [[nodiscard]] std::vector<unsigned char> read_file(std::string_view path);
+
+#ifdef RB_COROUTINES
+    template<typename T = void>
+    class task;
+
+    namespace detail {
+        /**
+         * @brief Promise part shared by all result types.
+         */
+        class task_promise_base {
+        public:
+            /**
+             * @brief Resumes awaiting coroutine (or destroys detached one) once the task finished.
+             */
+            struct final_awaiter {
+                bool await_ready() const noexcept {
+                    return false;
+                }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                    task_promise_base& promise = handle.promise();
+
+                    if (promise.m_detached) {
+                        if (promise.m_exception) {
+                            std::terminate();
+                        }
+
+                        handle.destroy();
+                        return std::noop_coroutine();
+                    }
+
+                    return promise.m_continuation ? promise.m_continuation : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {
+                }
+            };
+
+            static void* operator new(std::size_t size) {
+                return allocate_frame(size);
+            }
+
+            static void operator delete(void* pointer, std::size_t size) {
+                deallocate_frame(pointer, size);
+            }
+
+            std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+
+            final_awaiter final_suspend() const noexcept {
+                return {};
+            }
+
+            void unhandled_exception() noexcept {
+                m_exception = std::current_exception();
+            }
+
+            void set_continuation(std::coroutine_handle<> continuation) noexcept {
+                m_continuation = continuation;
+            }
+
+            void detach() noexcept {
+                m_detached = true;
+            }
+
+        protected:
+            void rethrow_if_failed() const {
+                if (m_exception) {
+                    std::rethrow_exception(m_exception);
+                }
+            }
+
+        private:
+            std::coroutine_handle<> m_continuation;
+            std::exception_ptr m_exception;
+            bool m_detached = false;
+        };
+
+        /**
+         * @brief Promise storing a value.
+         */
+        template<typename T>
+        class task_promise : public task_promise_base {
+        public:
+            task<T> get_return_object() noexcept;
+
+            template<typename Value>
+            void return_value(Value&& value) {
+                ::new (static_cast<void*>(&m_value)) T(std::forward<Value>(value));
+                m_has_value = true;
+            }
+
+            T result() {
+                rethrow_if_failed();
+                return std::move(*std::launder(reinterpret_cast<T*>(&m_value)));
+            }
+
+            ~task_promise() {
+                if (m_has_value) {
+                    std::destroy_at(std::launder(reinterpret_cast<T*>(&m_value)));
+                }
+            }
+
+        private:
+            alignas(T) unsigned char m_value[sizeof(T)];
+            bool m_has_value = false;
+        };
+
+        /**
+         * @brief Promise of a task without value.
+         */
+        template<>
+        class task_promise<void> : public task_promise_base {
+        public:
+            task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {
+            }
+
+            void result() {
+                rethrow_if_failed();
+            }
+        };
+    }
+
+    /**
+     * @brief Lazily started coroutine producing a value of type T.
+     *        Starts when awaited (or detached) and resumes the awaiting coroutine
+     *        on the thread it finished on, without blocking any thread in between.
+     *        Exceptions propagate to the awaiting coroutine.
+     *
+     *        Frames are allocated with allocate_frame.
+     *
+     * @tparam T Type of the result.
+     */
+    template<typename T>
+    class [[nodiscard]] task {
+    public:
+        /**
+         * @brief Coroutine promise type.
+         */
+        using promise_type = detail::task_promise<T>;
+
+        /**
+         * @brief Construct an empty task.
+         */
+        task() noexcept = default;
+
+        /**
+         * @brief Construct a task owning coroutine handle.
+         *
+         * @param handle Coroutine handle.
+         */
+        explicit task(std::coroutine_handle<promise_type> handle) noexcept
+            : m_handle(handle) {
+        }
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        task(const task&) = delete;
+
+        /**
+         * @brief Enabled move constructor.
+         */
+        task(task&& other) noexcept
+            : m_handle(std::exchange(other.m_handle, nullptr)) {
+        }
+
+        /**
+         * @brief Destruct the task and its coroutine frame.
+         */
+        ~task() {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+        }
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        task& operator=(const task&) = delete;
+
+        /**
+         * @brief Enabled move assignment.
+         */
+        task& operator=(task&& other) noexcept {
+            std::swap(m_handle, other.m_handle);
+            return *this;
+        }
+
+        /**
+         * @brief Tell whether the task finished.
+         *
+         * @return True if finished, false otherwise.
+         */
+        [[nodiscard]] bool done() const noexcept {
+            return !m_handle || m_handle.done();
+        }
+
+        /**
+         * @brief Start the task without waiting for it. Coroutine frame
+         *        is destroyed once the task finishes.
+         *
+         * @warning Exception escaping a detached task terminates the program.
+         */
+        void detach() && {
+            auto handle = std::exchange(m_handle, nullptr);
+            handle.promise().detach();
+            handle.resume();
+        }
+
+        /**
+         * @brief Await the task from another coroutine.
+         */
+        auto operator co_await() && noexcept {
+            struct awaiter {
+                bool await_ready() const noexcept {
+                    return !handle || handle.done();
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+                    handle.promise().set_continuation(continuation);
+                    return handle;
+                }
+
+                T await_resume() {
+                    return handle.promise().result();
+                }
+
+                std::coroutine_handle<promise_type> handle;
+            };
+
+            return awaiter{ m_handle };
+        }
+
+    private:
+        /**
+         * @brief Owned coroutine handle.
+         */
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    namespace detail {
+        template<typename T>
+        task<T> task_promise<T>::get_return_object() noexcept {
+            return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+        }
+
+        inline task<void> task_promise<void>::get_return_object() noexcept {
+            return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+        }
+    }
+
+    /**
+     * @brief Resume the awaiting coroutine on a worker of the thread pool.
+     *
+     * @param pool Thread pool to continue on.
+     * @param priority Priority lane of the continuation.
+     *
+     * @return Awaitable object.
+     */
+    [[nodiscard]] inline auto schedule_on(thread_pool& pool, task_priority priority = task_priority::normal) noexcept {
+        struct awaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                pool.submit_detached(priority, [handle] { handle.resume(); });
+            }
+
+            void await_resume() const noexcept {
+            }
+
+            thread_pool& pool;
+            task_priority priority;
+        };
+
+        return awaiter{ pool, priority };
+    }
+
+    /**
+     * @brief Resume the awaiting coroutine on next dispatch of the frame scheduler,
+     *        usually in the next frame on the main thread.
+     *
+     * @param scheduler Frame scheduler dispatched by the main loop.
+     *
+     * @return Awaitable object.
+     */
+    [[nodiscard]] inline auto next_frame(frame_scheduler& scheduler) noexcept {
+        struct awaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                scheduler.post([](void* address) { std::coroutine_handle<>::from_address(address).resume(); }, handle.address());
+            }
+
+            void await_resume() const noexcept {
+            }
+
+            frame_scheduler& scheduler;
+        };
+
+        return awaiter{ scheduler };
+    }
+
+    /**
+     * @brief Read whole file as a background task of the thread pool.
+     *        Awaiting coroutine resumes on the worker that read the file.
+     *
+     * @param pool Thread pool to read on.
+     * @param path Path to the file.
+     *
+     * @return Awaitable object producing file content.
+     */
+    [[nodiscard]] inline auto read_file(thread_pool& pool, std::string_view path) {
+        struct awaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                pool.submit_detached(task_priority::background, [this, handle] {
+                    try {
+                        content = rb::read_file(path);
+                    } catch (...) {
+                        exception = std::current_exception();
+                    }
+
+                    handle.resume();
+                });
+            }
+
+            std::vector<unsigned char> await_resume() {
+                if (exception) {
+                    std::rethrow_exception(exception);
+                }
+
+                return std::move(content);
+            }
+
+            thread_pool& pool;
+            std::string path;
+            std::vector<unsigned char> content;
+            std::exception_ptr exception;
+        };
+
+        return awaiter{ pool, std::string(path), {}, nullptr };
+    }
+#endif
+}
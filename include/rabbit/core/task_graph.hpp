@@ -0,0 +1,169 @@
+#pragma once 
+
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+namespace rb {
+    /**
+     * @brief Graph of jobs with dependencies executed on a thread pool.
+     *        Jobs without pending dependencies run concurrently and each finished job
+     *        releases its successors (fan-out), a job with several dependencies waits
+     *        for all of them (fan-in).
+     *
+     *        Graph is built once and can be executed many times (e.g. once per frame).
+     *        Running a graph that did not change since the last run does not allocate.
+     */
+    class task_graph {
+    public:
+        /**
+         * @brief Job identifier within the graph.
+         */
+        using job = std::size_t;
+
+        /**
+         * @brief Construct an empty graph.
+         */
+        task_graph() = default;
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        task_graph(const task_graph&) = delete;
+
+        /**
+         * @brief Enabled move constructor.
+         */
+        task_graph(task_graph&&) noexcept = default;
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        task_graph& operator=(const task_graph&) = delete;
+
+        /**
+         * @brief Enabled move assignment.
+         */
+        task_graph& operator=(task_graph&&) noexcept = default;
+
+        /**
+         * @brief Add a job to the graph.
+         *
+         * @param func Function to invoke each time the graph runs.
+         *
+         * @return Identifier of the added job.
+         */
+        template<typename Func>
+        job emplace(Func&& func) {
+            m_jobs.emplace_back().func = std::forward<Func>(func);
+            m_dirty = true;
+            return m_jobs.size() - 1;
+        }
+
+        /**
+         * @brief Make a job run only after another job finished.
+         *
+         * @param before Job to run first.
+         * @param after Job to run once the first one finished.
+         */
+        void precede(job before, job after);
+
+        /**
+         * @brief Add a job that runs after provided job finished.
+         *
+         * @param before Job to continue.
+         * @param func Function to invoke each time the graph runs.
+         *
+         * @return Identifier of the added job.
+         */
+        template<typename Func>
+        job then(job before, Func&& func) {
+            const job after = emplace(std::forward<Func>(func));
+            precede(before, after);
+            return after;
+        }
+
+        /**
+         * @brief Remove all jobs and dependencies.
+         */
+        void clear();
+
+        /**
+         * @brief Get number of jobs in the graph.
+         *
+         * @return Number of jobs.
+         */
+        [[nodiscard]] std::size_t size() const;
+
+        /**
+         * @brief Execute all jobs respecting their dependencies and wait until all of them finish.
+         *        Calling thread executes jobs too. If a job throws, jobs that were not started
+         *        are skipped and the first exception is rethrown once the graph finished.
+         *        Jobs are submitted with critical priority, so background tasks never delay them.
+         *
+         * @warning Graph must be acyclic and must not be modified while running.
+         *
+         * @param pool Thread pool to execute jobs on.
+         */
+        void run(thread_pool& pool);
+
+    private:
+        /**
+         * @brief Job function with its outgoing edges.
+         */
+        struct job_data {
+            std::function<void()> func;
+            std::vector<job> successors;
+            std::size_t dependency_count = 0;
+        };
+
+        /**
+         * @brief Recompute roots and check the graph is acyclic.
+         */
+        void prepare();
+
+        /**
+         * @brief Execute a job and schedule successors it released.
+         */
+        void execute(job id);
+
+        /**
+         * @brief Submit a job into the thread pool of the current run.
+         */
+        void schedule(job id);
+
+        /**
+         * @brief Jobs of the graph.
+         */
+        std::vector<job_data> m_jobs;
+
+        /**
+         * @brief Jobs with no dependencies.
+         */
+        std::vector<job> m_roots;
+
+        /**
+         * @brief Number of unfinished dependencies of each job during a run.
+         */
+        std::unique_ptr<std::atomic<std::size_t>[]> m_remaining;
+
+        /**
+         * @brief Tell whether jobs or dependencies changed since last run.
+         */
+        bool m_dirty = false;
+
+        /**
+         * @brief State shared by jobs of a single run.
+         */
+        struct run_data;
+
+        /**
+         * @brief State of the current run, null if graph is not running.
+         */
+        run_data* m_run = nullptr;
+    };
+}
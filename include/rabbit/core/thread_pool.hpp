@@ -1,18 +1,118 @@
 #pragma once 
 
-#include <mutex>
-#include <queue>
+#include <tuple>
+#include <atomic>
 #include <thread>
-#include <vector>
 #include <memory>
-#include <atomic>
 #include <future>
+#include <cstddef>
 #include <functional>
 #include <type_traits>
 
 namespace rb {
     /**
-     * @brief Thread pool.
+     * @brief Defines scheduling classes of tasks. Workers always look for
+     *        higher priority tasks first.
+     */
+    enum class task_priority : unsigned char {
+        /**
+         * @brief Work the current frame waits for.
+         */
+        critical,
+
+        /**
+         * @brief Regular work.
+         */
+        normal,
+
+        /**
+         * @brief Long running work like asset decoding or file I/O.
+         *        Never executed by threads helping in thread_pool::wait().
+         */
+        background
+    };
+
+    /**
+     * @brief Lightweight completion token. Counts tasks submitted
+     *        with it that did not finish yet. Owned by the caller,
+     *        so tracking completion does not allocate.
+     *
+     *        Tasks submitted with a cancelled counter that did not start yet
+     *        are dropped without running.
+     *
+     * @warning Counter must outlive all tasks submitted with it.
+     */
+    class task_counter {
+        friend class thread_pool;
+
+    public:
+        /**
+         * @brief Construct a new counter with no tasks.
+         */
+        task_counter() = default;
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        task_counter(const task_counter&) = delete;
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        task_counter& operator=(const task_counter&) = delete;
+
+        /**
+         * @brief Tell whether all tasks submitted with the counter have finished.
+         *
+         * @return True if there are no unfinished tasks, false otherwise.
+         */
+        [[nodiscard]] bool done() const {
+            return m_count.load(std::memory_order_acquire) == 0;
+        }
+
+        /**
+         * @brief Drop tasks submitted with the counter that did not start yet.
+         *        Tasks already running are not interrupted.
+         */
+        void cancel() {
+            m_cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Tell whether the counter has been cancelled.
+         *
+         * @return True if cancelled, false otherwise.
+         */
+        [[nodiscard]] bool cancelled() const {
+            return m_cancelled.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Number of unfinished tasks.
+         */
+        std::atomic<std::size_t> m_count = 0;
+
+        /**
+         * @brief Cancellation flag.
+         */
+        std::atomic<bool> m_cancelled = false;
+    };
+
+    /**
+     * @brief Work-stealing thread pool.
+     *
+     *        Each worker owns a Chase-Lev deque. Tasks submitted from a worker thread
+     *        are pushed to its own deque, tasks submitted from other threads go to a
+     *        global injection queue. Idle workers steal from other workers, spin for
+     *        a while and then park until new work arrives.
+     *
+     *        Tasks are divided into priority lanes, each lane has its own queues
+     *        and a limit of workers that can execute its tasks at the same time.
+     *        By default background tasks can occupy all workers but one.
+     *
+     *        Tasks are stored in fixed-size nodes with inline storage recycled through
+     *        per-thread caches, so detached submission does not allocate in steady state.
      */
     class thread_pool {
     public:
@@ -31,7 +131,7 @@ namespace rb {
         /**
          * @brief Enabled move constructor.
          */
-        thread_pool(thread_pool&&) noexcept = default;
+        thread_pool(thread_pool&&) noexcept;
 
         /**
          * @brief Disabled copy assignment.
@@ -41,7 +141,7 @@ namespace rb {
         /**
          * @brief Enabled move assignment.
          */
-        thread_pool& operator=(thread_pool&&) noexcept = default;
+        thread_pool& operator=(thread_pool&&) noexcept;
 
         /**
          * @brief Destruct the thread pool.
@@ -50,66 +150,271 @@ namespace rb {
 
         /**
          * @brief Submit a function with zero or more arguments into the task queue.
-         * 
+         *        The only allocation is the shared state of the returned future.
+         *
          * @tparam Func The type of the function.
          * @tparam Args The types of arguments to pass to the function.
          * @tparam Ret The return type of the function.
-         * 
+         *
          * @param func The function to submit.
          * @param args The arguments to pass to the function.
-         * 
+         *
          * @return A future to be used later to wait for the function to finish and obtain its returned value.
          */
         template<typename Func, typename... Args, typename Ret = std::invoke_result_t<std::decay_t<Func>, std::decay_t<Args>...>>
         [[nodiscard]] std::future<Ret> submit(Func&& func, Args&&... args) {
-            std::function<Ret()> task = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
-            std::shared_ptr<std::promise<Ret>> promise = std::make_shared<std::promise<Ret>>();
+            return submit(task_priority::normal, std::forward<Func>(func), std::forward<Args>(args)...);
+        }
 
-            {
-                std::unique_lock lock(m_mutex);
-                m_tasks.push([task, promise] {
+        /**
+         * @brief Submit a function with zero or more arguments into the task queue of given priority.
+         *        The only allocation is the shared state of the returned future.
+         *
+         * @param priority Priority lane of the task.
+         * @param func The function to submit.
+         * @param args The arguments to pass to the function.
+         *
+         * @return A future to be used later to wait for the function to finish and obtain its returned value.
+         */
+        template<typename Func, typename... Args, typename Ret = std::invoke_result_t<std::decay_t<Func>, std::decay_t<Args>...>>
+        [[nodiscard]] std::future<Ret> submit(task_priority priority, Func&& func, Args&&... args) {
+            std::promise<Ret> promise;
+            std::future<Ret> future = promise.get_future();
+
+            schedule(priority, nullptr, [promise = std::move(promise), func = std::forward<Func>(func), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                try {
                     if constexpr (std::is_void_v<Ret>) {
-                        std::invoke(task);
-                        promise->set_value();
+                        std::apply(func, std::move(args));
+                        promise.set_value();
                     } else {
-                        promise->set_value(std::invoke(task));
+                        promise.set_value(std::apply(func, std::move(args)));
                     }
-                });
-            }
+                } catch (...) {
+                    promise.set_exception(std::current_exception());
+                }
+            });
 
-            m_available.notify_one();
-            return promise->get_future();
+            return future;
         }
 
+        /**
+         * @brief Submit a function with zero or more arguments into the task queue
+         *        without a way to obtain its result. Does not allocate in steady state
+         *        as long as the function and arguments fit in a task node.
+         *
+         * @warning Exception escaping the function terminates the program.
+         *
+         * @param func The function to submit.
+         * @param args The arguments to pass to the function.
+         */
+        template<typename Func, typename... Args>
+        void submit_detached(Func&& func, Args&&... args) {
+            schedule(task_priority::normal, nullptr, bind(std::forward<Func>(func), std::forward<Args>(args)...));
+        }
+
+        /**
+         * @brief Submit a function with zero or more arguments into the task queue of given priority
+         *        without a way to obtain its result.
+         *
+         * @warning Exception escaping the function terminates the program.
+         *
+         * @param priority Priority lane of the task.
+         * @param func The function to submit.
+         * @param args The arguments to pass to the function.
+         */
+        template<typename Func, typename... Args>
+        void submit_detached(task_priority priority, Func&& func, Args&&... args) {
+            schedule(priority, nullptr, bind(std::forward<Func>(func), std::forward<Args>(args)...));
+        }
+
+        /**
+         * @brief Submit a function with zero or more arguments into the task queue
+         *        and track its completion with provided counter.
+         *
+         * @warning Exception escaping the function terminates the program.
+         *
+         * @param counter Counter to increment now and decrement once function finishes.
+         * @param func The function to submit.
+         * @param args The arguments to pass to the function.
+         */
+        template<typename Func, typename... Args>
+        void submit_detached(task_counter& counter, Func&& func, Args&&... args) {
+            submit_detached(task_priority::normal, counter, std::forward<Func>(func), std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Submit a function with zero or more arguments into the task queue of given priority
+         *        and track its completion with provided counter.
+         *
+         * @warning Exception escaping the function terminates the program.
+         *
+         * @param priority Priority lane of the task.
+         * @param counter Counter to increment now and decrement once function finishes or is dropped.
+         * @param func The function to submit.
+         * @param args The arguments to pass to the function.
+         */
+        template<typename Func, typename... Args>
+        void submit_detached(task_priority priority, task_counter& counter, Func&& func, Args&&... args) {
+            counter.m_count.fetch_add(1, std::memory_order_relaxed);
+            schedule(priority, &counter, bind(std::forward<Func>(func), std::forward<Args>(args)...));
+        }
+
+        /**
+         * @brief Wait until all tasks submitted with the counter finish.
+         *        Calling thread executes pending critical and normal tasks instead of blocking.
+         *
+         * @param counter Counter to wait for.
+         */
+        void wait(const task_counter& counter);
+
+        /**
+         * @brief Get number of worker threads.
+         *
+         * @return Number of worker threads.
+         */
+        [[nodiscard]] unsigned int thread_count() const;
+
+        /**
+         * @brief Limit number of workers executing tasks of given priority at the same time.
+         *
+         * @param priority Priority lane to limit.
+         * @param count Maximum number of workers, at least one.
+         */
+        void set_thread_limit(task_priority priority, unsigned int count);
+
+        /**
+         * @brief Get maximum number of workers executing tasks of given priority at the same time.
+         *
+         * @param priority Priority lane.
+         *
+         * @return Maximum number of workers.
+         */
+        [[nodiscard]] unsigned int thread_limit(task_priority priority) const;
+
     private:
         /**
-         * @brief A worker function to be assigned to each thread in the pool.
+         * @brief Fixed-size task node with inline storage for the callable.
+         *        Callables that do not fit are stored on the heap.
+         */
+        struct task {
+            /**
+             * @brief Size of the inline storage.
+             */
+            static constexpr std::size_t storage_size = 96;
+
+            /**
+             * @brief Invoke and destroy stored callable.
+             */
+            void (*invoke)(task&);
+
+            /**
+             * @brief Destroy stored callable without invoking it.
+             */
+            void (*destroy)(task&);
+
+            /**
+             * @brief Optional completion token.
+             */
+            task_counter* counter;
+
+            /**
+             * @brief Inline storage for the callable.
+             */
+            alignas(std::max_align_t) unsigned char storage[storage_size];
+        };
+
+        /**
+         * @brief Bind arguments to the function without type erasure.
+         */
+        template<typename Func, typename... Args>
+        static auto bind(Func&& func, Args&&... args) {
+            if constexpr (sizeof...(Args) == 0) {
+                return std::forward<Func>(func);
+            } else {
+                return [func = std::forward<Func>(func), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                    std::apply(func, std::move(args));
+                };
+            }
+        }
+
+        /**
+         * @brief Store callable in a task node and enqueue it.
+         *
+         * @param priority Priority lane of the task.
+         * @param counter Optional completion token.
+         * @param func Callable to store.
          */
-        void worker();
+        template<typename Func>
+        void schedule(task_priority priority, task_counter* counter, Func&& func) {
+            using callable_type = std::decay_t<Func>;
+
+            task* node = allocate();
+            node->counter = counter;
+
+            try {
+                if constexpr (sizeof(callable_type) <= task::storage_size && alignof(callable_type) <= alignof(std::max_align_t)) {
+                    ::new (static_cast<void*>(node->storage)) callable_type(std::forward<Func>(func));
+
+                    node->invoke = [](task& node) {
+                        callable_type& callable = *std::launder(reinterpret_cast<callable_type*>(node.storage));
+                        std::invoke(callable);
+                        std::destroy_at(&callable);
+                    };
+
+                    node->destroy = [](task& node) {
+                        std::destroy_at(std::launder(reinterpret_cast<callable_type*>(node.storage)));
+                    };
+                } else {
+                    ::new (static_cast<void*>(node->storage)) callable_type*(new callable_type(std::forward<Func>(func)));
+
+                    node->invoke = [](task& node) {
+                        std::unique_ptr<callable_type> callable(*std::launder(reinterpret_cast<callable_type**>(node.storage)));
+                        std::invoke(*callable);
+                    };
+
+                    node->destroy = [](task& node) {
+                        delete *std::launder(reinterpret_cast<callable_type**>(node.storage));
+                    };
+                }
+            } catch (...) {
+                deallocate(node);
+                throw;
+            }
+
+            enqueue(priority, node);
+        }
 
         /**
-         * @brief An atomic variable indicating to the workers to keep running. 
+         * @brief Get task node from the current thread cache.
+         *
+         * @return Uninitialized task node.
          */
-        std::atomic<bool> m_running = true;
+        static task* allocate();
 
         /**
-         * @brief  A condition variable used to notify worker() that a new task has become available.
+         * @brief Return task node to the current thread cache.
+         *
+         * @param node Task node with destroyed callable.
          */
-        std::condition_variable m_available;
+        static void deallocate(task* node);
 
         /**
-         * @brief A mutex to synchronize access to the task queue by different threads.
+         * @brief Push a task to the current worker deque or to the injection queue
+         *        and wake up a parked worker if any.
+         *
+         * @param priority Priority lane of the task.
+         * @param node Task to schedule.
          */
-        mutable std::mutex m_mutex;
+        void enqueue(task_priority priority, task* node);
 
         /**
-         * @brief A queue of tasks to be executed by the threads.
+         * @brief Implementation specific data structure.
          */
-        std::queue<std::function<void()>> m_tasks;
+        struct data;
 
         /**
-         * @brief Active workers container.
+         * @brief Implementation specific data pointer.
          */
-        std::vector<std::thread> m_threads;
+        std::unique_ptr<data> m_data;
     };
 }
@@ -6,6 +6,8 @@
 #include "../core/reference.hpp"
 
 #include <memory>
+#include <vector>
+#include <cstdint>
 #include <unordered_map>
 
 namespace rb {
@@ -34,6 +36,11 @@ namespace rb {
      */
     class font : public reference {
     public:
+        /**
+         * @brief Fonts rasterize glyphs into their atlas texture on demand.
+         */
+        using reference_policy = single_threaded;
+
         /**
          * @brief Disable default construction.
          */
@@ -41,6 +48,10 @@ namespace rb {
 
         /**
          * @brief Construct a new font.
+         *        Throws std::runtime_error if data is not a valid font or cooked font.
+         *
+         * @param renderer Renderer to create atlas with.
+         * @param data Content of a font file or a font cooked by cook.
          */
         font(renderer& renderer, span<const unsigned char> data);
 
@@ -95,6 +106,26 @@ namespace rb {
          */
         const texture& atlas() const;
 
+        /**
+         * @brief Get the size of memory used by the font, including texture atlas.
+         *
+         * @return Size of the font in bytes.
+         */
+        [[nodiscard]] std::size_t memory_size() const;
+
+        /**
+         * @brief Rasterize glyphs ahead of time. Cooked font holds the font file together
+         *        with the glyph atlas, so loading it does not rasterize the glyphs again.
+         *        Other glyphs are still rasterized on demand.
+         *
+         * @param data Content of a font file.
+         * @param character_size Character size to rasterize glyphs at.
+         * @param codepoints Codepoints of glyphs to rasterize.
+         *
+         * @return Cooked font.
+         */
+        [[nodiscard]] static std::vector<std::uint8_t> cook(span<const unsigned char> data, unsigned int character_size, span<const unsigned int> codepoints);
+
     private:
         /**
          * @brief Impementation defined data structure.
@@ -4,6 +4,8 @@
 #include "../math/vec2.hpp"
 
 #include <memory>
+#include <vector>
+#include <cstdint>
 #include <string_view>
 
 namespace rb {
@@ -38,6 +40,7 @@ namespace rb {
 
         /** 
          * @brief Load image from file.
+         *        Throws std::runtime_error if file cannot be read or decoded.
          * 
          * @param path Image filename path to load.
          * @param fix_alpha_border Tell whether alpha border should be fixed.
@@ -45,6 +48,17 @@ namespace rb {
          * @return Loaded image.
          */
         static image from(std::string_view path, bool fix_alpha_border = false);
+
+        /**
+         * @brief Decode image from encoded file content in memory.
+         *        Throws std::runtime_error if data is not a supported image.
+         *
+         * @param data Encoded image, e.g. content of a PNG file.
+         * @param fix_alpha_border Tell whether alpha border should be fixed.
+         *
+         * @return Decoded image.
+         */
+        static image from_memory(span<const std::uint8_t> data, bool fix_alpha_border = false);
         
         /**
          * @brief Disabled copy constructor.
@@ -87,6 +101,29 @@ namespace rb {
          */
         [[nodiscard]] std::size_t stride() const;
 
+        /**
+         * @brief Make next mipmap level of the image using a box filter.
+         *
+         * @return Image of half the size, at least 1x1 pixels.
+         */
+        [[nodiscard]] image downsample() const;
+
+        /**
+         * @brief Make all mipmap levels below the image, each downsampled from the previous one.
+         *
+         * @return Mipmap levels down to 1x1 pixels, largest first.
+         */
+        [[nodiscard]] std::vector<image> mipmaps() const;
+
+        /**
+         * @brief Get number of mipmap levels of a full chain, including the largest level.
+         *
+         * @param size Size of the largest level in pixels.
+         *
+         * @return Number of mipmap levels.
+         */
+        [[nodiscard]] static std::uint32_t mip_count(const uvec2& size);
+
     private:
         /**
          * @brief Construct a new image.
@@ -10,6 +10,8 @@
 #include "../math/rect.hpp"
 
 #include <memory>
+#include <cstddef>
+#include <cstdint>
 
 namespace rb {
     /**
@@ -110,10 +112,11 @@ namespace rb {
          * @param size Texture size in pixels.
          * @param filter Texture filtering type.
          * @param format Texture pixel format.
+         * @param mip_count Number of mipmap levels, 1 for texture without mipmaps.
          * 
          * @return Handle for newly created texture.
          */
-        [[nodiscard]] handle create_texture(const uvec2& size, texture_filter filter, pixel_format format);
+        [[nodiscard]] handle create_texture(const uvec2& size, texture_filter filter, pixel_format format, std::uint32_t mip_count = 1);
 
         /**
          * @brief Destroy texture associated with provided handle.
@@ -127,6 +130,8 @@ namespace rb {
 
         /**
          * @brief Update a texture created before.
+         *        Pixels are staged and uploaded ahead of the next displayed frame,
+         *        the call does not wait for the GPU.
          * 
          * @warning Attempting to setup a texture that is invalid 
          *          or being destroyed results in undefined behavior.
@@ -135,9 +140,29 @@ namespace rb {
          * 
          * @param id Texture handle.
          * @param pixels Pixels data with pixel layout determined by a format.
+         *               Holds all mipmap levels one after another, largest first.
+         *               Level sizes are halved and rounded down to at least one pixel,
+         *               block compressed levels are padded to whole blocks.
          */
         void update_texture_data(handle id, const void* pixels);
 
+        /**
+         * @brief Update a rectangle of the largest mipmap level of a texture.
+         *        Pixels are staged and uploaded when the next frame is displayed,
+         *        regions of a texture updated during a frame are uploaded by a single copy.
+         *        Pixels outside of rectangles of a texture never set up by update_texture_data are undefined.
+         *
+         * @warning Attempting to update a texture that is invalid
+         *          or being destroyed results in undefined behavior.
+         *          Rectangles of block compressed textures must be aligned to blocks.
+         *
+         * @param id Texture handle.
+         * @param rect Rectangle to update in pixels.
+         * @param pixels Pixels of the rectangle, starting at its top-left corner.
+         * @param stride Distance between rows of pixels in bytes, rows of blocks for block compressed formats.
+         */
+        void update_texture_region(handle id, const irect& rect, const void* pixels, std::size_t stride);
+
         /**
          * @brief Tell whether texture handle is valid.
          *
@@ -169,6 +194,16 @@ namespace rb {
          */
         [[nodiscard]] pixel_format get_texture_format(handle id) const;
 
+        /**
+         * @brief Get number of texture mipmap levels.
+         *
+         * @warning Attempting to fetch a texture that is invalid
+         *          or being destroyed results in undefined behavior.
+         *
+         * @return Number of mipmap levels.
+         */
+        [[nodiscard]] std::uint32_t get_texture_mip_count(handle id) const;
+
         /**
          * @brief Add draw primitives command to the render queue.
          *
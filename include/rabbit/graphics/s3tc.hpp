@@ -1,17 +1,60 @@
 #pragma once 
 
 #include "image.hpp"
+#include "../core/thread_pool.hpp"
 
 #include <vector>
 #include <cstddef>
+#include <functional>
 
 namespace rb {
+    /**
+     * @brief Trade-off between S3TC encoding speed and quality.
+     */
+    enum class s3tc_quality {
+        /**
+         * @brief Range fit of block bounding box. Fast enough to encode in frame.
+         */
+        fast,
+
+        /**
+         * @brief Least squares fit. Suitable for textures generated at load time.
+         */
+        normal,
+
+        /**
+         * @brief Cluster fit over likely selector orderings. Suitable for offline cooking.
+         */
+        best
+    };
+
     /** 
-     * @brief S3TC compressor.
+     * @brief S3TC compressor. Images of any size can be encoded, blocks crossing
+     *        the image edge repeat edge pixels (e.g. 2x2 and 1x1 mipmap levels).
      */
     class s3tc {
     public:
-    public:
+        /**
+         * @brief Function reporting progress of parallel encoding. Invoked with number of
+         *        encoded block rows and total number of block rows. Invoked from worker threads,
+         *        but never concurrently.
+         */
+        using progress_callback = std::function<void(std::size_t, std::size_t)>;
+
+        /**
+         * @brief Construct a new compressor.
+         *
+         * @param quality Encoding quality.
+         */
+        s3tc(s3tc_quality quality = s3tc_quality::normal);
+
+        /**
+         * @brief Get encoding quality.
+         *
+         * @return Encoding quality.
+         */
+        [[nodiscard]] s3tc_quality quality() const;
+
         void bc1(const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels) const;
 
         void bc3(const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels) const;
@@ -19,5 +62,59 @@ namespace rb {
         [[nodiscard]] std::vector<std::uint8_t> bc1(const image& image) const;
 
         [[nodiscard]] std::vector<std::uint8_t> bc3(const image& image) const;
+
+        /**
+         * @brief Encode pixels to BC1 using the thread pool. Bands of block rows are encoded
+         *        concurrently, output is identical to the serial encoding.
+         *
+         * @param pool Thread pool to run on.
+         * @param uncompressed_pixels RGBA pixels.
+         * @param uncompressed_size Size of pixels in bytes.
+         * @param stride Size of pixel row in bytes.
+         * @param compressed_pixels Encoded blocks.
+         * @param progress Function reporting progress or empty function.
+         */
+        void bc1(thread_pool& pool, const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels, const progress_callback& progress = {}) const;
+
+        /**
+         * @brief Encode pixels to BC3 using the thread pool. Bands of block rows are encoded
+         *        concurrently, output is identical to the serial encoding.
+         *
+         * @param pool Thread pool to run on.
+         * @param uncompressed_pixels RGBA pixels.
+         * @param uncompressed_size Size of pixels in bytes.
+         * @param stride Size of pixel row in bytes.
+         * @param compressed_pixels Encoded blocks.
+         * @param progress Function reporting progress or empty function.
+         */
+        void bc3(thread_pool& pool, const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels, const progress_callback& progress = {}) const;
+
+        /**
+         * @brief Encode image to BC1 using the thread pool.
+         *
+         * @param pool Thread pool to run on.
+         * @param image Image to encode.
+         * @param progress Function reporting progress or empty function.
+         *
+         * @return Encoded blocks.
+         */
+        [[nodiscard]] std::vector<std::uint8_t> bc1(thread_pool& pool, const image& image, const progress_callback& progress = {}) const;
+
+        /**
+         * @brief Encode image to BC3 using the thread pool.
+         *
+         * @param pool Thread pool to run on.
+         * @param image Image to encode.
+         * @param progress Function reporting progress or empty function.
+         *
+         * @return Encoded blocks.
+         */
+        [[nodiscard]] std::vector<std::uint8_t> bc3(thread_pool& pool, const image& image, const progress_callback& progress = {}) const;
+
+    private:
+        /**
+         * @brief Encoding quality.
+         */
+        s3tc_quality m_quality;
     };
 }
@@ -13,6 +13,11 @@ namespace rb {
      */
     class texture : public reference {
     public:
+        /**
+         * @brief Textures are created and updated through the renderer, which is not thread-safe.
+         */
+        using reference_policy = single_threaded;
+
         /**
          * @brief Disable default construction.
          */
@@ -25,8 +30,9 @@ namespace rb {
          * @param size Texture size in pixels.
          * @param filter Texture filter type.
          * @param format Texture pixel format.
+         * @param mip_count Number of mipmap levels.
          */
-        texture(renderer& renderer, const uvec2& size, texture_filter filter, pixel_format format);
+        texture(renderer& renderer, const uvec2& size, texture_filter filter, pixel_format format, std::uint32_t mip_count = 1);
 
         /**
          * @brief Disabled copy constructor.
@@ -64,9 +70,19 @@ namespace rb {
          * @brief Update a texture data.
          *
          * @param pixels Pixels data with pixel layout determined by a format.
+         *               Holds all mipmap levels, largest first.
          */
         void update(const void* pixels);
 
+        /**
+         * @brief Update a rectangle of the texture data.
+         *
+         * @param rect Rectangle to update in pixels.
+         * @param pixels Pixels of the rectangle, starting at its top-left corner.
+         * @param stride Distance between rows of pixels in bytes.
+         */
+        void update(const irect& rect, const void* pixels, std::size_t stride);
+
         /**
          * @brief Tell whether attached texture handle is valid.
          * 
@@ -95,6 +111,41 @@ namespace rb {
          */
         [[nodiscard]] pixel_format format() const;
 
+        /**
+         * @brief Get number of mipmap levels of the texture.
+         *
+         * @return Number of mipmap levels.
+         */
+        [[nodiscard]] std::uint32_t mip_count() const;
+
+        /**
+         * @brief Get the size of texture memory.
+         *
+         * @return Size of the texture in bytes, including mipmap levels.
+         */
+        [[nodiscard]] std::size_t memory_size() const;
+
+        /**
+         * @brief Get size of pixels of mipmap levels, as passed to update.
+         *
+         * @param size Size of the largest level in pixels.
+         * @param format Pixel format.
+         * @param mip_count Number of mipmap levels.
+         *
+         * @return Size of pixels in bytes.
+         */
+        [[nodiscard]] static std::size_t memory_size(const uvec2& size, pixel_format format, std::uint32_t mip_count = 1);
+
+        /**
+         * @brief Get size of a mipmap level.
+         *
+         * @param size Size of the largest level in pixels.
+         * @param level Index of the level.
+         *
+         * @return Size of the level in pixels, at least 1x1.
+         */
+        [[nodiscard]] static uvec2 level_size(const uvec2& size, std::uint32_t level);
+
     private:
         /**
          * @biref Renderer to which this texture is attached.
@@ -2,6 +2,7 @@
 
 #include "../graphics/renderer.hpp"
 #include "../graphics/font.hpp"
+#include "../core/pack.hpp"
 
 #include <string_view>
 
@@ -15,8 +16,9 @@ namespace rb {
          * @brief Construct new font loader.
          *
          * @param renderer Reference to renderer.
+         * @param pack Pack to look for fonts in first or null.
          */
-        font_loader(renderer& renderer);
+        font_loader(renderer& renderer, const pack* pack = nullptr);
 
         /**
          * @brief Disabled copy constructor.
@@ -45,10 +47,33 @@ namespace rb {
          */
         [[nodiscard]] font operator()(std::string_view path) const;
 
+        /**
+         * @brief Read font file. Thread-safe.
+         *
+         * @param path Path to the font.
+         *
+         * @return Font file content.
+         */
+        [[nodiscard]] file_view decode(std::string_view path) const;
+
+        /**
+         * @brief Create font from file content. Must be called on the main thread.
+         *
+         * @param file Font file content.
+         *
+         * @return Loaded font.
+         */
+        [[nodiscard]] font finish(file_view file) const;
+
     private:
         /**
          * @brief Renderer reference.
          */
         renderer& m_renderer;
+
+        /**
+         * @brief Pack to look for fonts in first.
+         */
+        const pack* m_pack;
     };
 }
@@ -1,6 +1,7 @@
 #pragma once 
 
 #include "../graphics/image.hpp"
+#include "../core/pack.hpp"
 
 #include <string_view>
 
@@ -12,11 +13,25 @@ namespace rb {
      */
     class image_loader {
     public:
+        /**
+         * @brief Construct new image loader.
+         *
+         * @param pack Pack to look for images in first or null.
+         */
+        image_loader(const pack* pack = nullptr);
+
         /**
          * @brief Load new image from file.
+         *        Throws std::runtime_error if file is missing or cannot be decoded.
          * 
          * @return Loaded image.
          */
         [[nodiscard]] image operator()(std::string_view path) const;
+
+    private:
+        /**
+         * @brief Pack to look for images in first.
+         */
+        const pack* m_pack;
     };
 }
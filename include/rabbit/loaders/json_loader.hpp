@@ -1,7 +1,10 @@
 #pragma once 
 
 #include "../core/json.hpp"
+#include "../core/pack.hpp"
 
+#include <vector>
+#include <cstdint>
 #include <string_view>
 
 namespace rb {
@@ -9,16 +12,39 @@ namespace rb {
      * @brief Basically, you can just use json directly,
      *        but for convenient we create another utility class
      *        to fit others loaders.
-     *          
-     *        Also, we hide huge <fstream> headers in source file.
+     *
+     *        Also, files can be read from a pack and json
+     *        cooked to binary form by cook is parsed faster.
      */
     class json_loader {
     public:
+        /**
+         * @brief Construct new json loader.
+         *
+         * @param pack Pack to look for json files in first or null.
+         */
+        json_loader(const pack* pack = nullptr);
+
         /**
          * @brief Load new json from file.
          *
          * @return Loaded json.
          */
         [[nodiscard]] json operator()(std::string_view path) const;
+
+        /**
+         * @brief Convert json to binary form.
+         *
+         * @param value Json to convert.
+         *
+         * @return Cooked json.
+         */
+        [[nodiscard]] static std::vector<std::uint8_t> cook(const json& value);
+
+    private:
+        /**
+         * @brief Pack to look for json files in first.
+         */
+        const pack* m_pack;
     };
 }
@@ -2,12 +2,62 @@
 
 #include "../graphics/renderer.hpp"
 #include "../graphics/texture.hpp"
+#include "../graphics/image.hpp"
+#include "../graphics/s3tc.hpp"
+#include "../core/pack.hpp"
 
+#include <vector>
+#include <cstdint>
+#include <optional>
 #include <string_view>
 
 namespace rb {
+    /**
+     * @brief Texture pixels read from file, ready to upload.
+     */
+    struct texture_source {
+        /**
+         * @brief Size of the texture in pixels.
+         */
+        uvec2 size;
+
+        /**
+         * @brief Pixel format of the texture.
+         */
+        pixel_format format;
+
+        /**
+         * @brief Number of mipmap levels in pixels.
+         */
+        std::uint32_t mip_count;
+
+        /**
+         * @brief Pixels of all mipmap levels, largest first.
+         */
+        span<const std::uint8_t> pixels;
+
+        /**
+         * @brief File content, pixels of cooked textures point into it.
+         */
+        file_view file;
+
+        /**
+         * @brief Decoded image, pixels of image files without mipmaps point into it.
+         */
+        std::optional<image> decoded;
+
+        /**
+         * @brief Decoded image with generated mipmap levels, pixels of image files with mipmaps point into it.
+         */
+        std::vector<std::uint8_t> levels;
+    };
+
     /**
      * @brief Utility class for loading textures from files.
+     *
+     *        Loads image files as well as cooked textures produced by cook, which hold
+     *        pixels in GPU format (optionally S3TC compressed, with mipmaps) and need no decoding.
+     *        Mipmaps of image files are generated while decoding.
      */
     class texture_loader {
     public:
@@ -15,8 +65,10 @@ namespace rb {
          * @brief Construct new texture loader.
          * 
          * @param renderer Reference to renderer.
+         * @param pack Pack to look for textures in first or null.
+         * @param mipmaps Tell whether mipmap levels should be generated for image files.
          */
-        texture_loader(renderer& renderer);
+        texture_loader(renderer& renderer, const pack* pack = nullptr, bool mipmaps = true);
 
         /**
          * @brief Disabled copy constructor.
@@ -45,10 +97,52 @@ namespace rb {
          */
         [[nodiscard]] texture operator()(std::string_view path) const;
 
+        /**
+         * @brief Read texture from file and decode it if needed. Thread-safe.
+         *        Throws std::runtime_error if file is missing, cannot be decoded
+         *        or cooked texture is corrupted.
+         *
+         * @param path Path to the texture.
+         *
+         * @return Texture pixels.
+         */
+        [[nodiscard]] texture_source decode(std::string_view path) const;
+
+        /**
+         * @brief Create texture from its pixels. Must be called on the main thread.
+         *
+         * @param source Texture pixels.
+         *
+         * @return Loaded texture.
+         */
+        [[nodiscard]] texture finish(texture_source source) const;
+
+        /**
+         * @brief Convert image to cooked texture.
+         *
+         * @param image Image to convert. Edge blocks of S3TC formats are padded.
+         * @param format Pixel format of cooked texture, rgba8, bc1 or bc3.
+         * @param mipmaps Tell whether mipmap levels should be generated.
+         * @param quality Encoding quality of S3TC formats.
+         *
+         * @return Cooked texture.
+         */
+        [[nodiscard]] static std::vector<std::uint8_t> cook(const image& image, pixel_format format, bool mipmaps, s3tc_quality quality = s3tc_quality::normal);
+
     private:
         /**
          * @brief Renderer reference.
          */
         renderer& m_renderer;
+
+        /**
+         * @brief Pack to look for textures in first.
+         */
+        const pack* m_pack;
+
+        /**
+         * @brief Tell whether mipmap levels should be generated for image files.
+         */
+        bool m_mipmaps;
     };
 }
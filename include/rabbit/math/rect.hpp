@@ -39,6 +39,16 @@ namespace rb {
                 point.y >= position.y && point.y < position.y + size.y;
         }
 
+        /**
+         * @brief Check if rectangles share any point.
+         *
+         * @return True if rectangles intersect, false otherwise.
+         */
+        bool intersects(const basic_rect<T>& other) const {
+            return position.x < other.position.x + other.size.x && other.position.x < position.x + size.x &&
+                position.y < other.position.y + other.size.y && other.position.y < position.y + size.y;
+        }
+
         /**
          * @brief Ending corner. This is calculated as position + size.
          */
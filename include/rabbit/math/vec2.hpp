@@ -234,7 +234,7 @@ namespace rb {
          * @return Distance between two points.
          */
         [[nodiscard]] T distance_to(const basic_vec2<T>& vec) const {
-            return length(vec - *this)
+            return length(vec - *this);
         }
 
         /**
@@ -273,7 +273,6 @@ namespace rb {
          *
          * @return Rotated point around a pivot.
          */
-        template<typename T>
         [[nodiscard]] basic_vec2<T> rotated(const basic_vec2<T>& pivot, T angle) const {
             // Compute sinus and cosinus from angle in radians.
             T s = std::sin(angle);
@@ -244,7 +244,7 @@ namespace rb {
          * @return Distance between two points.
          */
         [[nodiscard]] T distance_to(const basic_vec3<T>& vec) const {
-            return length(vec - *this)
+            return length(vec - *this);
         }
 
         /**
@@ -0,0 +1,140 @@
+#pragma once 
+
+#include "../core/task.hpp"
+#include "../core/reactive.hpp"
+
+#include <deque>
+#include <cassert>
+#include <utility>
+
+namespace rb {
+    /**
+     * @brief Queue of network messages of a single type received by a client or a server.
+     *        Messages arrive during dispatch of the endpoint and can be popped later
+     *        or awaited from a coroutine, which is then resumed inside dispatch.
+     *
+     * @warning Inbox must not be destroyed while its endpoint dispatches messages.
+     *
+     * @tparam Event Type of the message.
+     */
+    template<typename Event>
+    class inbox {
+    public:
+        /**
+         * @brief Construct a new inbox and start receiving messages.
+         *
+         * @param endpoint Client or server to receive messages from.
+         */
+        template<typename Endpoint>
+        explicit inbox(Endpoint& endpoint) {
+            m_connection = endpoint.template on<Event>().template connect<&inbox::push>(*this);
+        }
+
+        /**
+         * @brief Disabled copy constructor.
+         */
+        inbox(const inbox&) = delete;
+
+        /**
+         * @brief Disabled copy assignment.
+         */
+        inbox& operator=(const inbox&) = delete;
+
+        /**
+         * @brief Stop receiving messages.
+         */
+        ~inbox() {
+            m_connection.release();
+        }
+
+        /**
+         * @brief Pop the oldest received message.
+         *
+         * @param event Message to write to.
+         *
+         * @return True if a message has been popped, false if inbox is empty.
+         */
+        bool pop(Event& event) {
+            if (m_events.empty()) {
+                return false;
+            }
+
+            event = std::move(m_events.front());
+            m_events.pop_front();
+            return true;
+        }
+
+        /**
+         * @brief Get number of received messages not popped yet.
+         *
+         * @return Number of messages.
+         */
+        [[nodiscard]] std::size_t size() const {
+            return m_events.size();
+        }
+
+#ifdef RB_COROUTINES
+        /**
+         * @brief Wait for the next message. Awaiting coroutine resumes immediately
+         *        if a message is queued, otherwise inside dispatch of the endpoint.
+         *
+         * @warning Only one coroutine can wait at a time.
+         *
+         * @return Awaitable object producing the message.
+         */
+        [[nodiscard]] auto receive() noexcept {
+            struct awaiter {
+                bool await_ready() const noexcept {
+                    return !self.m_events.empty();
+                }
+
+                void await_suspend(std::coroutine_handle<> handle) noexcept {
+                    assert(!self.m_waiting && "Inbox is already awaited");
+                    self.m_waiting = handle;
+                }
+
+                Event await_resume() {
+                    Event event = std::move(self.m_events.front());
+                    self.m_events.pop_front();
+                    return event;
+                }
+
+                inbox& self;
+            };
+
+            return awaiter{ *this };
+        }
+#endif
+
+    private:
+        /**
+         * @brief Queue received message and resume waiting coroutine if any.
+         */
+        void push(Event& event) {
+            m_events.push_back(event);
+
+#ifdef RB_COROUTINES
+            if (m_waiting) {
+                std::exchange(m_waiting, nullptr).resume();
+            }
+#endif
+        }
+
+        /**
+         * @brief Received messages.
+         */
+        std::deque<Event> m_events;
+
+        /**
+         * @brief Connection to the endpoint sink.
+         */
+        connection m_connection;
+
+#ifdef RB_COROUTINES
+        /**
+         * @brief Coroutine waiting for a message.
+         */
+        std::coroutine_handle<> m_waiting;
+#endif
+    };
+}
@@ -10,6 +10,11 @@ namespace rb {
      */
     class body : public reference {
     public:
+        /**
+         * @brief Bodies are only touched by the physics world stepping them.
+         */
+        using reference_policy = single_threaded;
+
         /**
          * @brief Disable default construction.
          */
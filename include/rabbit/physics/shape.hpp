@@ -9,6 +9,11 @@ namespace rb {
      */
     class shape : public reference {
     public:
+        /**
+         * @brief Shapes are shared between bodies of the same physics world.
+         */
+        using reference_policy = single_threaded;
+
         /**
          * @brief Disable default construction.
          */
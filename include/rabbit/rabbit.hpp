@@ -7,15 +7,22 @@
 #include "config/version.hpp"
 
 #include "core/arena.hpp"
+#include "core/asset_id.hpp"
+#include "core/asset_report.hpp"
 #include "core/assets.hpp"
 #include "core/compressor.hpp"
 #include "core/format.hpp"
 #include "core/handle.hpp"
 #include "core/json.hpp"
+#include "core/object_pool.hpp"
+#include "core/pack.hpp"
+#include "core/parallel.hpp"
 #include "core/reactive.hpp"
 #include "core/reference.hpp"
 #include "core/span.hpp"
 #include "core/stopwatch.hpp"
+#include "core/task.hpp"
+#include "core/task_graph.hpp"
 #include "core/thread_pool.hpp"
 #include "core/type_info.hpp"
 
@@ -45,6 +52,7 @@
 #include "math/vec4.hpp"
 
 #include "network/client.hpp"
+#include "network/inbox.hpp"
 #include "network/server.hpp"
 
 #include "physics/body.hpp"
@@ -0,0 +1,211 @@
+#include <rabbit/core/asset_report.hpp>
+#include <rabbit/core/format.hpp>
+#include <rabbit/core/json.hpp>
+
+#include <iterator>
+#include <algorithm>
+
+using namespace rb;
+
+namespace {
+    /**
+     * @brief Metrics of the asset loaded on this thread, null if none.
+     */
+    thread_local asset_metrics* current_metrics = nullptr;
+
+    bool longer(const asset_report::load_record& a, const asset_report::load_record& b) {
+        return a.metrics.total_time() > b.metrics.total_time();
+    }
+
+    json metrics_json(const asset_metrics& metrics) {
+        return {
+            { "bytes_read", metrics.bytes_read },
+            { "read_ms", metrics.read_time * 1000.0f },
+            { "decode_ms", metrics.decode_time * 1000.0f },
+            { "upload_ms", metrics.upload_time * 1000.0f },
+            { "total_ms", metrics.total_time() * 1000.0f }
+        };
+    }
+
+    json totals_json(const asset_report::type_totals& totals) {
+        json value = metrics_json(totals.metrics);
+        value["loads"] = totals.loads;
+        value["hits"] = totals.hits;
+        value["joins"] = totals.joins;
+        value["failures"] = totals.failures;
+        return value;
+    }
+
+    std::string totals_row(std::string_view name, const asset_report::type_totals& totals) {
+        const asset_metrics& metrics = totals.metrics;
+        return format("{:<24} {:>7} {:>7} {:>7} {:>7} {:>12.1f} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f}\n",
+            name, totals.loads, totals.hits, totals.joins, totals.failures, metrics.bytes_read / 1024.0,
+            metrics.read_time * 1000.0f, metrics.decode_time * 1000.0f, metrics.upload_time * 1000.0f, metrics.total_time() * 1000.0f);
+    }
+}
+
+asset_metrics_scope::asset_metrics_scope(asset_metrics& metrics, float asset_metrics::* phase)
+    : m_metrics(metrics), m_phase(phase), m_read_time(metrics.read_time), m_previous(current_metrics) {
+    current_metrics = &metrics;
+}
+
+asset_metrics_scope::~asset_metrics_scope() {
+    const float elapsed = m_stopwatch.time();
+    const float read_time = m_metrics.read_time - m_read_time;
+
+    // Read time is measured inside the scope, so the phase gets only the rest.
+    if (m_phase != &asset_metrics::read_time) {
+        m_metrics.*m_phase += std::max(elapsed - read_time, 0.0f);
+    }
+
+    current_metrics = m_previous;
+}
+
+void asset_metrics_scope::read(std::size_t bytes, float time) {
+    if (current_metrics) {
+        current_metrics->bytes_read += bytes;
+        current_metrics->read_time += time;
+    }
+}
+
+void asset_report::name(id_type type, std::string_view name) {
+    totals(type).name = name;
+}
+
+void asset_report::hit(id_type type) {
+    ++totals(type).hits;
+}
+
+void asset_report::join(id_type type) {
+    ++totals(type).joins;
+}
+
+void asset_report::load(std::string_view path, id_type type, const asset_metrics& metrics, bool loaded) {
+    type_totals& type_totals = totals(type);
+    ++type_totals.loads;
+    type_totals.failures += loaded ? 0 : 1;
+    type_totals.metrics += metrics;
+
+    if (m_trace_size == 0) {
+        return;
+    }
+
+    // Heap keeps the shortest traced load on top, so it is the one replaced.
+    if (m_trace.size() == m_trace_size) {
+        if (metrics.total_time() <= m_trace.front().metrics.total_time()) {
+            return;
+        }
+
+        std::pop_heap(m_trace.begin(), m_trace.end(), longer);
+        m_trace.pop_back();
+    }
+
+    m_trace.push_back({ std::string(path), type_totals.name, metrics });
+    std::push_heap(m_trace.begin(), m_trace.end(), longer);
+}
+
+void asset_report::set_trace(std::size_t count) {
+    m_trace_size = count;
+
+    std::sort_heap(m_trace.begin(), m_trace.end(), longer);
+    if (m_trace.size() > count) {
+        m_trace.resize(count);
+    }
+    std::make_heap(m_trace.begin(), m_trace.end(), longer);
+}
+
+std::vector<asset_report::type_totals> asset_report::types() const {
+    std::vector<type_totals> types;
+    std::copy_if(m_types.begin(), m_types.end(), std::back_inserter(types), [](const type_totals& totals) {
+        return totals.loads > 0 || totals.hits > 0 || totals.joins > 0;
+    });
+
+    // Type indices depend on registration order, names are stable between runs.
+    std::sort(types.begin(), types.end(), [](const type_totals& a, const type_totals& b) {
+        return a.name < b.name;
+    });
+
+    return types;
+}
+
+asset_report::type_totals asset_report::total() const {
+    type_totals total;
+    for (const type_totals& totals : m_types) {
+        total.loads += totals.loads;
+        total.hits += totals.hits;
+        total.joins += totals.joins;
+        total.failures += totals.failures;
+        total.metrics += totals.metrics;
+    }
+
+    return total;
+}
+
+std::vector<asset_report::load_record> asset_report::trace() const {
+    std::vector<load_record> trace = m_trace;
+    std::sort_heap(trace.begin(), trace.end(), longer);
+    return trace;
+}
+
+std::string asset_report::to_string() const {
+    std::string report = format("{:<24} {:>7} {:>7} {:>7} {:>7} {:>12} {:>10} {:>10} {:>10} {:>10}\n",
+        "type", "loads", "hits", "joined", "failed", "read KB", "read ms", "decode ms", "upload ms", "total ms");
+
+    for (const type_totals& totals : types()) {
+        report += totals_row(totals.name, totals);
+    }
+
+    report += totals_row("total", total());
+
+    if (!m_trace.empty()) {
+        report += "\nlongest loads:\n";
+
+        for (const load_record& record : trace()) {
+            const asset_metrics& metrics = record.metrics;
+            report += format("{:>10.2f} ms  {} ({}, {} bytes, read {:.2f} ms, decode {:.2f} ms, upload {:.2f} ms)\n",
+                metrics.total_time() * 1000.0f, record.path, record.type, metrics.bytes_read,
+                metrics.read_time * 1000.0f, metrics.decode_time * 1000.0f, metrics.upload_time * 1000.0f);
+        }
+    }
+
+    return report;
+}
+
+std::string asset_report::to_json() const {
+    json report = { { "types", json::object() }, { "total", totals_json(total()) } };
+
+    for (const type_totals& totals : types()) {
+        report["types"][std::string(totals.name)] = totals_json(totals);
+    }
+
+    if (!m_trace.empty()) {
+        json& trace = report["trace"] = json::array();
+
+        for (const load_record& record : this->trace()) {
+            json value = metrics_json(record.metrics);
+            value["path"] = record.path;
+            value["type"] = record.type;
+            trace.push_back(std::move(value));
+        }
+    }
+
+    return report.dump(4);
+}
+
+void asset_report::clear() {
+    for (type_totals& totals : m_types) {
+        const std::string_view name = totals.name;
+        totals = type_totals{};
+        totals.name = name;
+    }
+
+    m_trace.clear();
+}
+
+asset_report::type_totals& asset_report::totals(id_type type) {
+    if (type >= m_types.size()) {
+        m_types.resize(type + 1);
+    }
+
+    return m_types[type];
+}
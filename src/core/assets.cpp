@@ -0,0 +1,189 @@
+#include <rabbit/core/assets.hpp>
+#include <rabbit/core/stopwatch.hpp>
+
+#include <cassert>
+
+using namespace rb;
+
+assets::assets(thread_pool& pool)
+    : m_pool(&pool) {
+}
+
+assets::~assets() {
+    if (m_pool) {
+        m_decoding.cancel();
+        m_pool->wait(m_decoding);
+    }
+}
+
+void assets::dispatch(float time_budget) {
+    stopwatch stopwatch;
+
+    // Assets released since last dispatch can be evicted now.
+    trim();
+
+    do {
+        ref<asset_request> request;
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_decoded.empty()) {
+                return;
+            }
+
+            request = std::move(m_decoded.front());
+            m_decoded.pop_front();
+        }
+
+        const asset_id id = request->path();
+
+        // Asset might have been loaded synchronously in the meantime.
+        ref<reference> asset = find(id, request->m_type);
+        if (!asset && request->m_finish) {
+            try {
+                const asset_type& type = m_types[request->m_type];
+                asset_metrics_scope scope(request->m_metrics, type.split ? &asset_metrics::upload_time : &asset_metrics::decode_time);
+                asset = request->m_finish();
+            } catch (...) {
+            }
+
+            if (asset) {
+                asset = insert(id, request->m_type, std::move(asset));
+            }
+        }
+
+        // Decoding has been done even if the asset was loaded in the meantime.
+        m_report.load(id.path(), request->m_type, request->m_metrics, (bool)asset);
+
+        request->m_finish = nullptr;
+        m_pending.erase(key(id, request->m_type));
+        complete(*request, std::move(asset));
+    } while (stopwatch.time() < time_budget);
+}
+
+std::size_t assets::pending() const {
+    return m_pending.size();
+}
+
+asset_id assets::intern(std::string_view path) {
+    const std::string& interned = m_interned.try_emplace(asset_id::hash(path), path).first->second;
+    assert(interned == path && "Asset path hash collision");
+    return interned;
+}
+
+void assets::trim() {
+    for (asset_type& type : m_types) {
+        trim(type);
+    }
+}
+
+assets::asset_type& assets::type(id_type index) {
+    if (index >= m_types.size()) {
+        m_types.resize(index + 1);
+    }
+
+    return m_types[index];
+}
+
+ref<reference> assets::load(const asset_id& id, id_type index) {
+    asset_metrics metrics;
+    ref<reference> asset;
+
+    try {
+        std::function<ref<reference>()> finish;
+        {
+            asset_metrics_scope scope(metrics, &asset_metrics::decode_time);
+            finish = m_types[index].decode(id.path());
+        }
+
+        // Loaders that do not split finish by loading the whole asset.
+        asset_metrics_scope scope(metrics, m_types[index].split ? &asset_metrics::upload_time : &asset_metrics::decode_time);
+        asset = finish();
+    } catch (...) {
+        m_report.load(id.path(), index, metrics, false);
+        throw;
+    }
+
+    m_report.load(id.path(), index, metrics, (bool)asset);
+
+    return asset ? insert(id, index, std::move(asset)) : asset;
+}
+
+reference* assets::find(const asset_id& id, id_type index) {
+    auto loaded = m_assets.find(key(id, index));
+    if (loaded == m_assets.end()) {
+        return nullptr;
+    }
+
+    assert(loaded->second.path == id.path() && loaded->second.type == index && "Asset path hash collision");
+
+    asset_type& type = m_types[loaded->second.type];
+    type.order.splice(type.order.begin(), type.order, loaded->second.position);
+    return loaded->second.asset.get();
+}
+
+ref<reference> assets::insert(const asset_id& id, id_type index, ref<reference> asset) {
+    auto [loaded, inserted] = m_assets.try_emplace(key(id, index));
+    if (!inserted) {
+        // Keep the cached asset, so every user shares it and its memory is counted once.
+        assert(loaded->second.path == id.path() && "Asset path hash collision");
+        return loaded->second.asset;
+    }
+
+    asset_type& type = m_types[index];
+    const std::size_t size = type.size(*asset);
+
+    // Map nodes are stable, so LRU list can point to them.
+    type.order.push_front(&*loaded);
+    loaded->second = { std::move(asset), std::string(id.path()), index, size, type.order.begin() };
+    type.used += size;
+
+    // Reference returned to the caller keeps the new asset from being evicted right away.
+    ref<reference> cached = loaded->second.asset;
+    trim(type);
+    return cached;
+}
+
+void assets::trim(asset_type& type) {
+    // Every asset is visited at most once. Assets still referenced elsewhere
+    // are in use, so they are moved to the front as recently used.
+    for (std::size_t remaining = type.order.size(); type.used > type.budget && remaining > 0; --remaining) {
+        cache_entry* loaded = type.order.back();
+
+        if (loaded->second.asset->use_count() > 1) {
+            type.order.splice(type.order.begin(), type.order, std::prev(type.order.end()));
+            continue;
+        }
+
+        type.used -= loaded->second.size;
+        type.order.pop_back();
+        m_assets.erase(loaded->first);
+    }
+}
+
+void assets::decode(ref<asset_request> request, decode_function decode) {
+    auto task = [this, request, decode = std::move(decode)] {
+        std::function<ref<reference>()> finish;
+
+        try {
+            asset_metrics_scope scope(request->m_metrics, &asset_metrics::decode_time);
+            finish = decode(request->path());
+        } catch (...) {
+        }
+
+        std::lock_guard lock(m_mutex);
+        request->m_finish = std::move(finish);
+        m_decoded.push_back(request);
+    };
+
+    if (m_pool) {
+        m_pool->submit_detached(task_priority::background, m_decoding, std::move(task));
+    } else {
+        task();
+    }
+}
+
+void assets::complete(asset_request& request, ref<reference> asset) {
+    const auto state = asset ? asset_request::state::ready : asset_request::state::failed;
+    request.m_asset = std::move(asset);
+    request.m_state.store(state, std::memory_order_release);
+}
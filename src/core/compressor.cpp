@@ -1,33 +1,674 @@
 #include <rabbit/core/compressor.hpp>
+#include <rabbit/core/parallel.hpp>
 
 #define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
 #include <miniz.h>
 
+#include <new>
+#include <memory>
+#include <cstring>
+#include <unordered_map>
+#include <istream>
+#include <ostream>
+
 using namespace rb;
 
+namespace {
+	struct deflator_deleter {
+		void operator()(tdefl_compressor* deflator) const {
+			tdefl_compressor_free(deflator);
+		}
+	};
+
+	struct inflator_deleter {
+		void operator()(tinfl_decompressor* inflator) const {
+			tinfl_decompressor_free(inflator);
+		}
+	};
+
+	/**
+	 * @brief Reusable compression and decompression state. Allocated on first use.
+	 */
+	struct codec_state {
+		tdefl_compressor& deflator() {
+			if (!m_deflator) {
+				m_deflator.reset(tdefl_compressor_alloc());
+
+				if (!m_deflator) {
+					throw std::bad_alloc();
+				}
+			}
+
+			return *m_deflator;
+		}
+
+		tinfl_decompressor& inflator() {
+			if (!m_inflator) {
+				m_inflator.reset(tinfl_decompressor_alloc());
+
+				if (!m_inflator) {
+					throw std::bad_alloc();
+				}
+			}
+
+			return *m_inflator;
+		}
+
+	private:
+		std::unique_ptr<tdefl_compressor, deflator_deleter> m_deflator;
+		std::unique_ptr<tinfl_decompressor, inflator_deleter> m_inflator;
+	};
+
+	/**
+	 * @brief State used by blocks compressed on worker threads.
+	 */
+	thread_local codec_state block_codec;
+
+	int miniz_level(compression_level level) {
+		switch (level) {
+			case compression_level::fastest:
+				return MZ_BEST_SPEED;
+			case compression_level::balanced:
+				return MZ_DEFAULT_LEVEL;
+			case compression_level::best:
+				return MZ_BEST_COMPRESSION;
+		}
+
+		return MZ_BEST_SPEED;
+	}
+
+	int deflate_flags(compression_level level) {
+		return int(tdefl_create_comp_flags_from_zip_params(miniz_level(level), MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+	}
+
+	/**
+	 * @brief Compress whole buffer into zlib stream reusing compressor state.
+	 */
+	std::size_t deflate(codec_state& codec, compression_level level, const void* uncompressed_data, std::size_t uncompressed_size, void* compressed_data, std::size_t compressed_bound) {
+		tdefl_compressor& deflator = codec.deflator();
+
+		if (tdefl_init(&deflator, nullptr, nullptr, deflate_flags(level)) != TDEFL_STATUS_OKAY) {
+			return 0;
+		}
+
+		std::size_t consumed_size = uncompressed_size;
+		std::size_t produced_size = compressed_bound;
+
+		const tdefl_status status = tdefl_compress(&deflator, uncompressed_data, &consumed_size, compressed_data, &produced_size, TDEFL_FINISH);
+		return status == TDEFL_STATUS_DONE ? produced_size : 0;
+	}
+
+	/**
+	 * @brief Uncompress whole zlib stream reusing decompressor state.
+	 */
+	std::size_t inflate(codec_state& codec, const void* compressed_data, std::size_t compressed_size, void* uncompressed_data, std::size_t uncompressed_size) {
+		tinfl_decompressor& inflator = codec.inflator();
+		tinfl_init(&inflator);
+
+		std::size_t consumed_size = compressed_size;
+		std::size_t produced_size = uncompressed_size;
+
+		const tinfl_status status = tinfl_decompress(&inflator,
+			(const mz_uint8*)compressed_data,
+			&consumed_size,
+			(mz_uint8*)uncompressed_data,
+			(mz_uint8*)uncompressed_data,
+			&produced_size,
+			TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+
+		return status == TINFL_STATUS_DONE ? produced_size : 0;
+	}
+
+	/**
+	 * @brief Header of block-compressed data. Followed by block_count + 1 offsets
+	 *        of blocks relative to the end of the index and by the blocks itself.
+	 */
+	struct block_header {
+		char magic[4];
+		std::uint32_t block_size;
+		std::uint64_t size;
+		std::uint64_t block_count;
+	};
+
+	constexpr char block_magic[4] = { 'R', 'B', 'B', 'K' };
+
+	/**
+	 * @brief Validated view of block-compressed data.
+	 */
+	struct block_view {
+		explicit block_view(span<const std::uint8_t> data) {
+			if (data.size() < sizeof(block_header)) {
+				return;
+			}
+
+			std::memcpy(&header, data.data(), sizeof(block_header));
+
+			if (std::memcmp(header.magic, block_magic, sizeof(block_magic)) != 0 || header.block_size == 0) {
+				return;
+			}
+
+			// Index holds block_count + 1 offsets. Count is bounded by the data first,
+			// so sizes derived from crafted headers cannot overflow.
+			const std::size_t max_offset_count = (data.size() - sizeof(block_header)) / sizeof(std::uint64_t);
+			if (max_offset_count == 0 || header.block_count > max_offset_count - 1) {
+				return;
+			}
+
+			if (header.block_count != header.size / header.block_size + (header.size % header.block_size != 0 ? 1 : 0)) {
+				return;
+			}
+
+			const std::size_t index_size = std::size_t(header.block_count + 1) * sizeof(std::uint64_t);
+			if (data.size() - sizeof(block_header) < index_size) {
+				return;
+			}
+
+			index = data.data() + sizeof(block_header);
+			blocks = span<const std::uint8_t>(index + index_size, data.size() - sizeof(block_header) - index_size);
+			valid = offset(header.block_count) <= blocks.size();
+		}
+
+		std::uint64_t offset(std::size_t block) const {
+			std::uint64_t value;
+			std::memcpy(&value, index + block * sizeof(std::uint64_t), sizeof(value));
+			return value;
+		}
+
+		std::size_t block_size(std::size_t block) const {
+			return std::size_t(std::min<std::uint64_t>(header.block_size, header.size - block * std::uint64_t(header.block_size)));
+		}
+
+		block_header header{};
+		const std::uint8_t* index = nullptr;
+		span<const std::uint8_t> blocks;
+		bool valid = false;
+	};
+
+	std::size_t inflate_block(codec_state& codec, const block_view& view, std::size_t index, void* uncompressed_data, std::size_t uncompressed_size) {
+		if (!view.valid || index >= view.header.block_count) {
+			return 0;
+		}
+
+		const std::uint64_t begin = view.offset(index);
+		const std::uint64_t end = view.offset(index + 1);
+		const std::size_t size = view.block_size(index);
+
+		if (begin > end || end > view.blocks.size() || uncompressed_size < size) {
+			return 0;
+		}
+
+		const std::size_t stored_size = std::size_t(end - begin);
+		if (stored_size == size) {
+			std::memcpy(uncompressed_data, view.blocks.data() + begin, size);
+			return size;
+		}
+
+		return inflate(codec, view.blocks.data() + begin, stored_size, uncompressed_data, size) == size ? size : 0;
+	}
+
+	std::size_t read_stream(std::istream& input, void* data, std::size_t size) {
+		input.read((char*)data, std::streamsize(size));
+		return std::size_t(input.gcount());
+	}
+
+	bool write_stream(std::ostream& output, const void* data, std::size_t size) {
+		output.write((const char*)data, std::streamsize(size));
+		return bool(output);
+	}
+}
+
+struct compressor::data {
+	codec_state codec;
+	compression_level level;
+
+	std::vector<std::uint8_t> scratch;
+	std::vector<std::uint8_t> stream_input;
+	std::vector<std::uint8_t> stream_output;
+
+	std::unordered_map<std::uint32_t, std::vector<std::uint8_t>> dictionaries;
+	std::vector<std::uint8_t> dictionary_scratch;
+};
+
+compressor::compressor(compression_level level)
+	: m_data(new data()) {
+	m_data->level = level;
+}
+
+compressor::compressor(compressor&&) noexcept = default;
+
+compressor::~compressor() = default;
+
+compressor& compressor::operator=(compressor&&) noexcept = default;
+
+void compressor::set_level(compression_level level) {
+	m_data->level = level;
+}
+
+compression_level compressor::level() const {
+	return m_data->level;
+}
+
 std::size_t compressor::bound(std::size_t uncompressed_size) const {
 	return std::size_t(mz_compressBound(mz_ulong(uncompressed_size)));
 }
 
 std::size_t compressor::compress(const void* uncompressed_data, std::size_t uncompressed_size, void* compressed_data, std::size_t compressed_bound) const {
-	mz_ulong compressed_size = mz_ulong(compressed_bound);
+	return deflate(m_data->codec, m_data->level, uncompressed_data, uncompressed_size, compressed_data, compressed_bound);
+}
+
+std::size_t compressor::uncompress(const void* compressed_data, std::size_t compressed_size, void* uncompressed_data, std::size_t uncompressed_size) const {
+	return inflate(m_data->codec, compressed_data, compressed_size, uncompressed_data, uncompressed_size);
+}
 
-	int status = mz_compress2((unsigned char*)compressed_data,
-		&compressed_size,
-		(const unsigned char*)uncompressed_data,
-		mz_ulong(uncompressed_size),
-		MZ_BEST_SPEED);
+std::size_t compressor::compress(span<const std::uint8_t> uncompressed_data, std::vector<std::uint8_t>& compressed_data) const {
+	compressed_data.resize(bound(uncompressed_data.size()));
 
-	return status == MZ_OK ? compressed_size : 0;
+	const std::size_t compressed_size = compress(uncompressed_data.data(), uncompressed_data.size(), compressed_data.data(), compressed_data.size());
+	compressed_data.resize(compressed_size);
+	return compressed_size;
 }
 
-std::size_t compressor::uncompress(const void* compressed_data, std::size_t compressed_size, void* uncompressed_data, std::size_t uncompressed_size) const {
-	mz_ulong uncompressed_size2 = mz_ulong(uncompressed_size);
+std::size_t compressor::uncompress(span<const std::uint8_t> compressed_data, std::size_t uncompressed_size, std::vector<std::uint8_t>& uncompressed_data) const {
+	uncompressed_data.resize(uncompressed_size);
+
+	const std::size_t size = uncompress(compressed_data.data(), compressed_data.size(), uncompressed_data.data(), uncompressed_data.size());
+	uncompressed_data.resize(size);
+	return size;
+}
+
+span<const std::uint8_t> compressor::compress_to_scratch(const void* uncompressed_data, std::size_t uncompressed_size) const {
+	std::vector<std::uint8_t>& scratch = m_data->scratch;
+	scratch.resize(bound(uncompressed_size));
+
+	const std::size_t compressed_size = compress(uncompressed_data, uncompressed_size, scratch.data(), scratch.size());
+	return { scratch.data(), compressed_size };
+}
+
+std::size_t compressor::compress_stream(const read_callback& read, const write_callback& write) const {
+	tdefl_compressor& deflator = m_data->codec.deflator();
+	if (tdefl_init(&deflator, nullptr, nullptr, deflate_flags(m_data->level)) != TDEFL_STATUS_OKAY) {
+		return 0;
+	}
+
+	std::vector<std::uint8_t>& input = m_data->stream_input;
+	std::vector<std::uint8_t>& output = m_data->stream_output;
+	input.resize(stream_chunk_size);
+	output.resize(stream_chunk_size);
+
+	std::size_t input_offset = 0;
+	std::size_t input_size = 0;
+	std::size_t compressed_size = 0;
+	bool input_end = false;
+
+	for (;;) {
+		if (input_size == 0 && !input_end) {
+			input_offset = 0;
+			input_size = read(input.data(), input.size());
+			input_end = input_size == 0;
+		}
+
+		std::size_t consumed_size = input_size;
+		std::size_t produced_size = output.size();
+
+		const tdefl_status status = tdefl_compress(&deflator,
+			input.data() + input_offset,
+			&consumed_size,
+			output.data(),
+			&produced_size,
+			input_end ? TDEFL_FINISH : TDEFL_NO_FLUSH);
+
+		input_offset += consumed_size;
+		input_size -= consumed_size;
+
+		if (produced_size > 0) {
+			if (!write(output.data(), produced_size)) {
+				return 0;
+			}
+
+			compressed_size += produced_size;
+		}
+
+		if (status == TDEFL_STATUS_DONE) {
+			return compressed_size;
+		}
+
+		if (status != TDEFL_STATUS_OKAY) {
+			return 0;
+		}
+	}
+}
+
+std::size_t compressor::uncompress_stream(const read_callback& read, const write_callback& write) const {
+	tinfl_decompressor& inflator = m_data->codec.inflator();
+	tinfl_init(&inflator);
+
+	// Without non-wrapping output flag the output buffer is a circular dictionary.
+	std::vector<std::uint8_t>& input = m_data->stream_input;
+	std::vector<std::uint8_t>& dictionary = m_data->stream_output;
+	input.resize(stream_chunk_size);
+	dictionary.resize(TINFL_LZ_DICT_SIZE);
+
+	std::size_t input_offset = 0;
+	std::size_t input_size = 0;
+	std::size_t dictionary_offset = 0;
+	std::size_t uncompressed_size = 0;
+	bool input_end = false;
+
+	for (;;) {
+		if (input_size == 0 && !input_end) {
+			input_offset = 0;
+			input_size = read(input.data(), input.size());
+			input_end = input_size == 0;
+		}
+
+		std::size_t consumed_size = input_size;
+		std::size_t produced_size = dictionary.size() - dictionary_offset;
 
-	int status = mz_uncompress((unsigned char*)uncompressed_data,
-		&uncompressed_size2,
-		(const unsigned char*)compressed_data,
-		mz_ulong(compressed_size));
+		const tinfl_status status = tinfl_decompress(&inflator,
+			input.data() + input_offset,
+			&consumed_size,
+			dictionary.data(),
+			dictionary.data() + dictionary_offset,
+			&produced_size,
+			TINFL_FLAG_PARSE_ZLIB_HEADER | (input_end ? 0 : TINFL_FLAG_HAS_MORE_INPUT));
 
-	return status == MZ_OK ? uncompressed_size2 : 0;
-}
\ No newline at end of file
+		input_offset += consumed_size;
+		input_size -= consumed_size;
+
+		if (produced_size > 0) {
+			if (!write(dictionary.data() + dictionary_offset, produced_size)) {
+				return 0;
+			}
+
+			dictionary_offset = (dictionary_offset + produced_size) & (TINFL_LZ_DICT_SIZE - 1);
+			uncompressed_size += produced_size;
+		}
+
+		if (status == TINFL_STATUS_DONE) {
+			return uncompressed_size;
+		}
+
+		if (status < TINFL_STATUS_DONE) {
+			return 0;
+		}
+	}
+}
+
+std::size_t compressor::compress_stream(std::istream& input, std::ostream& output) const {
+	return compress_stream([&input](void* data, std::size_t size) { return read_stream(input, data, size); },
+		[&output](const void* data, std::size_t size) { return write_stream(output, data, size); });
+}
+
+std::size_t compressor::uncompress_stream(std::istream& input, std::ostream& output) const {
+	return uncompress_stream([&input](void* data, std::size_t size) { return read_stream(input, data, size); },
+		[&output](const void* data, std::size_t size) { return write_stream(output, data, size); });
+}
+
+std::vector<std::uint8_t> compressor::compress_blocks(thread_pool& pool, span<const std::uint8_t> uncompressed_data, std::size_t block_size) const {
+	if (block_size == 0 || block_size > UINT32_MAX) {
+		return {};
+	}
+
+	const std::size_t block_count = (uncompressed_data.size() + block_size - 1) / block_size;
+	const std::size_t index_size = (block_count + 1) * sizeof(std::uint64_t);
+	const std::size_t slot_size = bound(block_size);
+
+	// Every block gets a worst-case slot, slots are compacted once all blocks are compressed.
+	std::vector<std::uint8_t> compressed_data(sizeof(block_header) + index_size + block_count * slot_size);
+	std::vector<std::size_t> sizes(block_count);
+
+	std::uint8_t* const slots = compressed_data.data() + sizeof(block_header) + index_size;
+
+	const compression_level level = m_data->level;
+
+	parallel_for(pool, std::size_t(0), block_count, 1, [&](std::size_t block) {
+		const std::uint8_t* source = uncompressed_data.data() + block * block_size;
+		const std::size_t size = std::min(block_size, uncompressed_data.size() - block * block_size);
+		std::uint8_t* slot = slots + block * slot_size;
+
+		sizes[block] = deflate(block_codec, level, source, size, slot, slot_size);
+
+		// Block is stored as is if it does not shrink, stored size equal to block size marks it.
+		if (sizes[block] == 0 || sizes[block] >= size) {
+			std::memcpy(slot, source, size);
+			sizes[block] = size;
+		}
+	});
+
+	std::uint64_t offset = 0;
+	for (std::size_t block = 0; block < block_count; ++block) {
+		std::memcpy(compressed_data.data() + sizeof(block_header) + block * sizeof(std::uint64_t), &offset, sizeof(offset));
+		std::memmove(slots + offset, slots + block * slot_size, sizes[block]);
+		offset += sizes[block];
+	}
+
+	std::memcpy(compressed_data.data() + sizeof(block_header) + block_count * sizeof(std::uint64_t), &offset, sizeof(offset));
+
+	block_header header;
+	std::memcpy(header.magic, block_magic, sizeof(block_magic));
+	header.block_size = std::uint32_t(block_size);
+	header.size = uncompressed_data.size();
+	header.block_count = block_count;
+	std::memcpy(compressed_data.data(), &header, sizeof(header));
+
+	compressed_data.resize(sizeof(block_header) + index_size + std::size_t(offset));
+	return compressed_data;
+}
+
+std::size_t compressor::uncompress_blocks(thread_pool& pool, span<const std::uint8_t> compressed_data, void* uncompressed_data, std::size_t uncompressed_size) const {
+	const block_view view(compressed_data);
+	if (!view.valid || uncompressed_size < view.header.size) {
+		return 0;
+	}
+
+	std::atomic<bool> failed = false;
+
+	parallel_for(pool, std::size_t(0), std::size_t(view.header.block_count), 1, [&](std::size_t block) {
+		std::uint8_t* output = (std::uint8_t*)uncompressed_data + block * std::size_t(view.header.block_size);
+		if (inflate_block(block_codec, view, block, output, view.block_size(block)) == 0) {
+			failed.store(true, std::memory_order_relaxed);
+		}
+	});
+
+	return failed ? 0 : std::size_t(view.header.size);
+}
+
+std::size_t compressor::uncompress_block(span<const std::uint8_t> compressed_data, std::size_t index, void* uncompressed_data, std::size_t uncompressed_size) const {
+	return inflate_block(m_data->codec, block_view(compressed_data), index, uncompressed_data, uncompressed_size);
+}
+
+std::size_t compressor::blocks_uncompressed_size(span<const std::uint8_t> compressed_data) const {
+	const block_view view(compressed_data);
+	return view.valid ? std::size_t(view.header.size) : 0;
+}
+
+std::size_t compressor::block_size(span<const std::uint8_t> compressed_data) const {
+	const block_view view(compressed_data);
+	return view.valid ? std::size_t(view.header.block_size) : 0;
+}
+
+std::size_t compressor::block_count(span<const std::uint8_t> compressed_data) const {
+	const block_view view(compressed_data);
+	return view.valid ? std::size_t(view.header.block_count) : 0;
+}
+
+void compressor::add_dictionary(std::uint32_t id, span<const std::uint8_t> dictionary) {
+	const std::size_t size = std::min(dictionary.size(), max_dictionary_size);
+	m_data->dictionaries[id].assign(dictionary.end() - size, dictionary.end());
+}
+
+void compressor::remove_dictionary(std::uint32_t id) {
+	m_data->dictionaries.erase(id);
+}
+
+std::size_t compressor::compress(std::uint32_t dictionary_id, const void* uncompressed_data, std::size_t uncompressed_size, void* compressed_data, std::size_t compressed_bound) const {
+	const auto dictionary = m_data->dictionaries.find(dictionary_id);
+	if (dictionary == m_data->dictionaries.end()) {
+		return 0;
+	}
+
+	// Raw deflate stream, zlib header would only waste bytes of small payloads.
+	const int flags = int(tdefl_create_comp_flags_from_zip_params(miniz_level(m_data->level), -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+
+	tdefl_compressor& deflator = m_data->codec.deflator();
+	if (tdefl_init(&deflator, nullptr, nullptr, flags) != TDEFL_STATUS_OKAY) {
+		return 0;
+	}
+
+	// Prime the window by compressing the dictionary and throwing its output away.
+	// Sync flush leaves the stream byte-aligned, so payload blocks start right after it.
+	std::vector<std::uint8_t>& scratch = m_data->dictionary_scratch;
+	scratch.resize(bound(dictionary->second.size()));
+
+	std::size_t consumed_size = dictionary->second.size();
+	std::size_t produced_size = scratch.size();
+
+	if (tdefl_compress(&deflator, dictionary->second.data(), &consumed_size, scratch.data(), &produced_size, TDEFL_SYNC_FLUSH) != TDEFL_STATUS_OKAY) {
+		return 0;
+	}
+
+	consumed_size = uncompressed_size;
+	produced_size = compressed_bound;
+
+	const tdefl_status status = tdefl_compress(&deflator, uncompressed_data, &consumed_size, compressed_data, &produced_size, TDEFL_FINISH);
+	return status == TDEFL_STATUS_DONE ? produced_size : 0;
+}
+
+std::size_t compressor::uncompress(std::uint32_t dictionary_id, const void* compressed_data, std::size_t compressed_size, void* uncompressed_data, std::size_t uncompressed_size) const {
+	const auto dictionary = m_data->dictionaries.find(dictionary_id);
+	if (dictionary == m_data->dictionaries.end()) {
+		return 0;
+	}
+
+	// Dictionary precedes the output, so back-references can reach into it.
+	const std::size_t dictionary_size = dictionary->second.size();
+
+	std::vector<std::uint8_t>& scratch = m_data->dictionary_scratch;
+	scratch.resize(dictionary_size + uncompressed_size);
+	std::memcpy(scratch.data(), dictionary->second.data(), dictionary_size);
+
+	tinfl_decompressor& inflator = m_data->codec.inflator();
+	tinfl_init(&inflator);
+
+	std::size_t consumed_size = compressed_size;
+	std::size_t produced_size = uncompressed_size;
+
+	const tinfl_status status = tinfl_decompress(&inflator,
+		(const mz_uint8*)compressed_data,
+		&consumed_size,
+		scratch.data(),
+		scratch.data() + dictionary_size,
+		&produced_size,
+		TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+
+	if (status != TINFL_STATUS_DONE) {
+		return 0;
+	}
+
+	std::memcpy(uncompressed_data, scratch.data() + dictionary_size, produced_size);
+	return produced_size;
+}
+
+std::vector<std::uint8_t> compressor::train_dictionary(span<const std::vector<std::uint8_t>> samples, std::size_t capacity, std::size_t segment_size) {
+	// Length of substrings counted across samples.
+	constexpr std::size_t substring_size = 8;
+	constexpr std::size_t table_bits = 20;
+	constexpr std::uint32_t no_substring = UINT32_MAX;
+
+	capacity = std::min(capacity, max_dictionary_size);
+	segment_size = std::max(segment_size, substring_size);
+
+	// Flatten samples, remember hash of substring starting at every position
+	// and count in how many distinct samples each substring occurs.
+	std::vector<std::uint8_t> corpus;
+	std::vector<std::uint32_t> owners;
+	std::vector<std::uint32_t> hashes;
+	std::vector<std::uint32_t> frequencies(std::size_t(1) << table_bits);
+	std::vector<std::uint32_t> last_owners(std::size_t(1) << table_bits, no_substring);
+
+	for (std::size_t owner = 0; owner < samples.size(); ++owner) {
+		const std::vector<std::uint8_t>& sample = samples[owner];
+
+		for (std::size_t i = 0; i < sample.size(); ++i) {
+			std::uint32_t hash = no_substring;
+
+			if (i + substring_size <= sample.size()) {
+				std::uint64_t value;
+				std::memcpy(&value, sample.data() + i, sizeof(value));
+				hash = std::uint32_t((value * 0x9E3779B185EBCA87ull) >> (64 - table_bits));
+
+				if (last_owners[hash] != owner) {
+					last_owners[hash] = std::uint32_t(owner);
+					++frequencies[hash];
+				}
+			}
+
+			corpus.push_back(sample[i]);
+			owners.push_back(std::uint32_t(owner));
+			hashes.push_back(hash);
+		}
+	}
+
+	// Substrings present in a single sample do not help other payloads.
+	const auto score = [&](std::size_t position) -> std::uint64_t {
+		const std::uint32_t hash = hashes[position];
+		return hash != no_substring && frequencies[hash] > 1 ? frequencies[hash] : 0;
+	};
+
+	std::vector<std::uint8_t> dictionary(capacity);
+	std::size_t free_size = capacity;
+
+	// Split corpus into epochs and pick the best segment of each epoch, so the
+	// dictionary covers the whole corpus. Repeat while segments are still found.
+	const std::size_t epoch_count = std::max<std::size_t>(capacity / segment_size, 1);
+	const std::size_t epoch_size = std::max(corpus.size() / epoch_count, segment_size);
+
+	bool found = true;
+	while (found && free_size >= segment_size) {
+		found = false;
+
+		for (std::size_t epoch_begin = 0; epoch_begin + segment_size <= corpus.size() && free_size >= segment_size; epoch_begin += epoch_size) {
+			const std::size_t epoch_end = std::min(epoch_begin + epoch_size, corpus.size() - segment_size + 1);
+
+			std::uint64_t window_score = 0;
+			for (std::size_t i = epoch_begin; i < epoch_begin + segment_size; ++i) {
+				window_score += score(i);
+			}
+
+			std::uint64_t best_score = 0;
+			std::size_t best_begin = 0;
+
+			for (std::size_t begin = epoch_begin; begin < epoch_end; ++begin) {
+				if (begin > epoch_begin) {
+					window_score += score(begin + segment_size - 1);
+					window_score -= score(begin - 1);
+				}
+
+				// Segments must not span multiple samples.
+				if (window_score > best_score && owners[begin] == owners[begin + segment_size - 1]) {
+					best_score = window_score;
+					best_begin = begin;
+				}
+			}
+
+			if (best_score == 0) {
+				continue;
+			}
+
+			free_size -= segment_size;
+			std::memcpy(dictionary.data() + free_size, corpus.data() + best_begin, segment_size);
+
+			// Covered substrings do not make other segments better anymore.
+			for (std::size_t i = best_begin; i < best_begin + segment_size; ++i) {
+				if (hashes[i] != no_substring) {
+					frequencies[hashes[i]] = 0;
+				}
+			}
+
+			found = true;
+		}
+	}
+
+	dictionary.erase(dictionary.begin(), dictionary.begin() + free_size);
+	return dictionary;
+}
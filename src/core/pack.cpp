@@ -0,0 +1,342 @@
+#include <rabbit/core/pack.hpp>
+#include <rabbit/core/task.hpp>
+#include <rabbit/core/asset_id.hpp>
+#include <rabbit/core/stopwatch.hpp>
+#include <rabbit/core/asset_report.hpp>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+using namespace rb;
+
+namespace {
+    /**
+     * @brief Archive signature, "RBPK".
+     */
+    constexpr std::uint32_t pack_magic = 0x4b504252;
+
+    /**
+     * @brief Archive format version.
+     */
+    constexpr std::uint32_t pack_version = 1;
+
+    /**
+     * @brief Entry is stored compressed.
+     */
+    constexpr std::uint32_t entry_compressed = 1;
+
+    /**
+     * @brief Archive header.
+     */
+    struct pack_header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t entry_count;
+        std::uint32_t names_size;
+    };
+
+    /**
+     * @brief Table of contents entry.
+     */
+    struct pack_entry {
+        std::uint64_t hash;
+        std::uint64_t offset;
+        std::uint64_t stored_size;
+        std::uint64_t size;
+        std::uint32_t name_offset;
+        std::uint32_t name_size;
+        std::uint32_t flags;
+        std::uint32_t reserved;
+    };
+
+    static_assert(sizeof(pack_header) == 16);
+    static_assert(sizeof(pack_entry) == 48);
+
+    std::size_t align_entry(std::size_t offset) {
+        return (offset + pack::entry_alignment - 1) & ~(pack::entry_alignment - 1);
+    }
+
+    thread_local compressor entry_compressor;
+}
+
+file_view::file_view(span<const std::uint8_t> data)
+    : m_data(data) {
+}
+
+file_view::file_view(std::vector<std::uint8_t> data)
+    : m_data(data.data(), data.size()), m_storage(std::move(data)) {
+}
+
+span<const std::uint8_t> file_view::bytes() const {
+    return m_data;
+}
+
+bool file_view::empty() const {
+    return m_data.empty();
+}
+
+struct pack::data {
+    ~data() {
+#ifdef _WIN32
+        if (bytes) {
+            UnmapViewOfFile(bytes);
+        }
+
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+#else
+        if (bytes) {
+            munmap((void*)bytes, size);
+        }
+#endif
+    }
+
+    bool map(std::string_view path) {
+#ifdef _WIN32
+        file = CreateFileA(std::string(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            return false;
+        }
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            return false;
+        }
+
+        bytes = (const std::uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        size = (std::size_t)file_size.QuadPart;
+        return bytes != nullptr;
+#else
+        const int file = ::open(std::string(path).c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+
+        struct stat file_stat;
+        if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0) {
+            ::close(file);
+            return false;
+        }
+
+        void* address = mmap(nullptr, (std::size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file);
+
+        if (address == MAP_FAILED) {
+            return false;
+        }
+
+        bytes = (const std::uint8_t*)address;
+        size = (std::size_t)file_stat.st_size;
+        return true;
+#endif
+    }
+
+    bool validate() {
+        if (size < sizeof(pack_header)) {
+            return false;
+        }
+
+        pack_header header;
+        std::memcpy(&header, bytes, sizeof(header));
+
+        if (header.magic != pack_magic || header.version != pack_version) {
+            return false;
+        }
+
+        const std::size_t names_offset = sizeof(pack_header) + std::size_t(header.entry_count) * sizeof(pack_entry);
+        if (names_offset + header.names_size > size) {
+            return false;
+        }
+
+        entries.resize(header.entry_count);
+        std::memcpy(entries.data(), bytes + sizeof(pack_header), entries.size() * sizeof(pack_entry));
+        names = { (const char*)bytes + names_offset, header.names_size };
+
+        for (const pack_entry& entry : entries) {
+            if (entry.offset > size || entry.stored_size > size - entry.offset || std::size_t(entry.name_offset) + entry.name_size > names.size()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const pack_entry* find(std::string_view path) const {
+        const std::uint64_t hash = asset_id::hash(path);
+
+        auto it = std::lower_bound(entries.begin(), entries.end(), hash, [](const pack_entry& entry, std::uint64_t hash) {
+            return entry.hash < hash;
+        });
+
+        for (; it != entries.end() && it->hash == hash; ++it) {
+            if (names.substr(it->name_offset, it->name_size) == path) {
+                return &*it;
+            }
+        }
+
+        return nullptr;
+    }
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+    const std::uint8_t* bytes = nullptr;
+    std::size_t size = 0;
+    std::vector<pack_entry> entries;
+    std::string_view names;
+};
+
+pack::pack() = default;
+
+pack::pack(std::string_view path)
+    : m_data(std::make_unique<data>()) {
+    if (!m_data->map(path) || !m_data->validate()) {
+        m_data.reset();
+    }
+}
+
+pack::pack(pack&&) noexcept = default;
+
+pack::~pack() = default;
+
+pack& pack::operator=(pack&&) noexcept = default;
+
+bool pack::is_open() const {
+    return m_data != nullptr;
+}
+
+std::size_t pack::size() const {
+    return m_data ? m_data->entries.size() : 0;
+}
+
+bool pack::contains(std::string_view path) const {
+    return m_data && m_data->find(path);
+}
+
+file_view pack::open(std::string_view path) const {
+    const pack_entry* entry = m_data ? m_data->find(path) : nullptr;
+    if (!entry) {
+        return {};
+    }
+
+    const span<const std::uint8_t> stored{ m_data->bytes + entry->offset, (std::size_t)entry->stored_size };
+    if (!(entry->flags & entry_compressed)) {
+        return file_view(stored);
+    }
+
+    std::vector<std::uint8_t> uncompressed;
+    if (entry_compressor.uncompress(stored, (std::size_t)entry->size, uncompressed) != entry->size) {
+        return {};
+    }
+
+    return file_view(std::move(uncompressed));
+}
+
+void pack_writer::add(std::string_view path, std::vector<std::uint8_t> data, bool compress) {
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [path](const entry& entry) {
+        return entry.path == path;
+    });
+
+    if (it != m_entries.end()) {
+        it->data = std::move(data);
+        it->compress = compress;
+    } else {
+        m_entries.push_back({ std::string(path), std::move(data), compress });
+    }
+}
+
+bool pack_writer::save(std::string_view path, compression_level level) const {
+    std::vector<const entry*> sorted(m_entries.size());
+    std::transform(m_entries.begin(), m_entries.end(), sorted.begin(), [](const entry& entry) {
+        return &entry;
+    });
+
+    std::sort(sorted.begin(), sorted.end(), [](const entry* a, const entry* b) {
+        const std::uint64_t a_hash = asset_id::hash(a->path), b_hash = asset_id::hash(b->path);
+        return a_hash != b_hash ? a_hash < b_hash : a->path < b->path;
+    });
+
+    std::vector<pack_entry> entries(sorted.size());
+    std::string names;
+
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        entries[i].hash = asset_id::hash(sorted[i]->path);
+        entries[i].name_offset = (std::uint32_t)names.size();
+        entries[i].name_size = (std::uint32_t)sorted[i]->path.size();
+        names += sorted[i]->path;
+    }
+
+    const pack_header header{ pack_magic, pack_version, (std::uint32_t)entries.size(), (std::uint32_t)names.size() };
+
+    std::ofstream file(std::string(path), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // Table of contents is written last, once offsets and sizes are known.
+    const std::size_t toc_size = sizeof(pack_header) + entries.size() * sizeof(pack_entry) + names.size();
+    std::size_t offset = align_entry(toc_size);
+    file.seekp((std::streamoff)offset);
+
+    const compressor codec{ level };
+    std::vector<std::uint8_t> compressed;
+
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        const std::vector<std::uint8_t>& data = sorted[i]->data;
+        span<const std::uint8_t> stored = data;
+
+        if (sorted[i]->compress && !data.empty()) {
+            const std::size_t compressed_size = codec.compress(data, compressed);
+            if (compressed_size > 0 && compressed_size < data.size()) {
+                stored = { compressed.data(), compressed_size };
+                entries[i].flags |= entry_compressed;
+            }
+        }
+
+        entries[i].offset = offset;
+        entries[i].stored_size = stored.size();
+        entries[i].size = data.size();
+
+        file.seekp((std::streamoff)offset);
+        file.write((const char*)stored.data(), (std::streamsize)stored.size());
+        offset = align_entry(offset + stored.size());
+    }
+
+    file.seekp(0);
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(pack_entry)));
+    file.write(names.data(), (std::streamsize)names.size());
+
+    return file.good();
+}
+
+file_view rb::open_file(const pack* pack, std::string_view path) {
+    stopwatch stopwatch;
+    file_view file = pack && pack->contains(path) ? pack->open(path) : file_view(read_file(path));
+
+    asset_metrics_scope::read(file.bytes().size(), stopwatch.time());
+    return file;
+}
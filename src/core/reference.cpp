@@ -8,6 +8,50 @@ void reference::retain() {
 
 void reference::release() {
     if (--m_count == 0) {
+        destroy();
+    }
+}
+
+void reference::retain_local() {
+    m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void reference::release_local() {
+    const int count = m_count.load(std::memory_order_relaxed) - 1;
+    m_count.store(count, std::memory_order_relaxed);
+
+    if (count == 0) {
+        destroy();
+    }
+}
+
+int reference::use_count() const {
+    return m_count.load(std::memory_order_relaxed);
+}
+
+void reference::destroy() {
+    if (m_deleter) {
+        m_deleter(this);
+    } else {
         delete this;
     }
 }
+
+release_queue::~release_queue() {
+    flush();
+}
+
+void release_queue::flush() {
+    // Releasing can destroy objects that push to this queue from their destructors.
+    for (std::size_t i = 0; i < m_entries.size(); ++i) {
+        const entry entry = m_entries[i];
+
+        if (entry.local) {
+            entry.ptr->release_local();
+        } else {
+            entry.ptr->release();
+        }
+    }
+
+    m_entries.clear();
+}
@@ -0,0 +1,112 @@
+#include <rabbit/core/task.hpp>
+
+#include <fstream>
+
+using namespace rb;
+
+namespace {
+    /**
+     * @brief Granularity of frame size classes.
+     */
+    constexpr std::size_t frame_granularity = 64;
+
+    /**
+     * @brief Number of frame size classes. Bigger frames bypass the pool.
+     */
+    constexpr std::size_t frame_class_count = 16;
+
+    /**
+     * @brief Maximum number of free frames kept per size class and thread.
+     */
+    constexpr std::size_t frame_cache_size = 64;
+
+    /**
+     * @brief Per-thread free lists of coroutine frames.
+     */
+    struct frame_cache {
+        /**
+         * @brief Free frame, links to the next free frame of the same class.
+         */
+        struct node {
+            node* next;
+        };
+
+        ~frame_cache() {
+            for (node* head : heads) {
+                while (head) {
+                    ::operator delete(std::exchange(head, head->next));
+                }
+            }
+        }
+
+        node* heads[frame_class_count] = {};
+        std::size_t counts[frame_class_count] = {};
+    };
+
+    thread_local frame_cache cache;
+}
+
+void frame_scheduler::post(callback_type callback, void* context) {
+    std::lock_guard lock(m_mutex);
+    m_posted.push_back({ callback, context });
+}
+
+void frame_scheduler::dispatch() {
+    {
+        std::lock_guard lock(m_mutex);
+        std::swap(m_posted, m_running);
+    }
+
+    for (const entry& entry : m_running) {
+        entry.callback(entry.context);
+    }
+
+    m_running.clear();
+}
+
+void* rb::allocate_frame(std::size_t size) {
+    const std::size_t index = (size - 1) / frame_granularity;
+    if (index >= frame_class_count) {
+        return ::operator new(size);
+    }
+
+    if (frame_cache::node* node = cache.heads[index]; node) {
+        cache.heads[index] = node->next;
+        --cache.counts[index];
+        return node;
+    }
+
+    return ::operator new((index + 1) * frame_granularity);
+}
+
+void rb::deallocate_frame(void* pointer, std::size_t size) {
+    const std::size_t index = (size - 1) / frame_granularity;
+    if (index >= frame_class_count || cache.counts[index] == frame_cache_size) {
+        ::operator delete(pointer);
+        return;
+    }
+
+    cache.heads[index] = ::new (pointer) frame_cache::node{ cache.heads[index] };
+    ++cache.counts[index];
+}
+
+std::vector<unsigned char> rb::read_file(std::string_view path) {
+    std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return {};
+    }
+
+    const std::streamsize size = file.tellg();
+    if (size <= 0) {
+        return {};
+    }
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<unsigned char> buffer((std::size_t)size);
+    file.read((char*)buffer.data(), size);
+
+    // File can shrink between querying its size and reading it.
+    buffer.resize((std::size_t)file.gcount());
+    return buffer;
+}
@@ -0,0 +1,121 @@
+#include <rabbit/core/task_graph.hpp>
+
+#include <cassert>
+
+using namespace rb;
+
+struct task_graph::run_data {
+    explicit run_data(thread_pool& pool)
+        : pool(pool) {
+    }
+
+    thread_pool& pool;
+    task_counter counter;
+    std::atomic<bool> failed = false;
+    std::exception_ptr exception;
+};
+
+void task_graph::precede(job before, job after) {
+    assert(before < m_jobs.size() && after < m_jobs.size() && before != after);
+
+    m_jobs[before].successors.push_back(after);
+    m_jobs[after].dependency_count++;
+    m_dirty = true;
+}
+
+void task_graph::clear() {
+    m_jobs.clear();
+    m_roots.clear();
+    m_remaining.reset();
+    m_dirty = false;
+}
+
+std::size_t task_graph::size() const {
+    return m_jobs.size();
+}
+
+void task_graph::run(thread_pool& pool) {
+    assert(!m_run && "Graph is already running");
+
+    if (m_dirty) {
+        prepare();
+    }
+
+    for (std::size_t i = 0; i < m_jobs.size(); ++i) {
+        m_remaining[i].store(m_jobs[i].dependency_count, std::memory_order_relaxed);
+    }
+
+    run_data run(pool);
+    m_run = &run;
+
+    for (job id : m_roots) {
+        schedule(id);
+    }
+
+    pool.wait(run.counter);
+    m_run = nullptr;
+
+    if (run.exception) {
+        std::rethrow_exception(run.exception);
+    }
+}
+
+void task_graph::prepare() {
+    m_remaining = std::make_unique<std::atomic<std::size_t>[]>(m_jobs.size());
+
+    m_roots.clear();
+    for (job id = 0; id < m_jobs.size(); ++id) {
+        if (m_jobs[id].dependency_count == 0) {
+            m_roots.push_back(id);
+        }
+    }
+
+#ifndef NDEBUG
+    // Kahn's algorithm: every job is reachable in topological order only if there are no cycles.
+    std::vector<std::size_t> remaining(m_jobs.size());
+    for (job id = 0; id < m_jobs.size(); ++id) {
+        remaining[id] = m_jobs[id].dependency_count;
+    }
+
+    std::vector<job> ready = m_roots;
+    std::size_t visited = 0;
+    while (!ready.empty()) {
+        const job id = ready.back();
+        ready.pop_back();
+        ++visited;
+
+        for (job successor : m_jobs[id].successors) {
+            if (--remaining[successor] == 0) {
+                ready.push_back(successor);
+            }
+        }
+    }
+
+    assert(visited == m_jobs.size() && "Task graph contains a cycle");
+#endif
+
+    m_dirty = false;
+}
+
+void task_graph::execute(job id) {
+    if (!m_run->failed.load(std::memory_order_relaxed)) {
+        try {
+            std::invoke(m_jobs[id].func);
+        } catch (...) {
+            if (!m_run->failed.exchange(true)) {
+                m_run->exception = std::current_exception();
+            }
+        }
+    }
+
+    // Release successors even after failure, so the run always completes.
+    for (job successor : m_jobs[id].successors) {
+        if (m_remaining[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            schedule(successor);
+        }
+    }
+}
+
+void task_graph::schedule(job id) {
+    m_run->pool.submit_detached(task_priority::critical, m_run->counter, [this, id] { execute(id); });
+}
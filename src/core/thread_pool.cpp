@@ -1,39 +1,591 @@
 #include <rabbit/core/thread_pool.hpp>
 
+#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
 using namespace rb;
 
+namespace {
+    /**
+     * @brief Chase-Lev work-stealing deque.
+     *        Owner thread pushes and pops at the bottom, other threads steal from the top.
+     *
+     * @see "Correct and Efficient Work-Stealing for Weak Memory Models", Le et al. 2013.
+     */
+    template<typename T>
+    class work_stealing_deque {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        /**
+         * @brief Circular array of items. Never shrinks.
+         */
+        struct ring {
+            explicit ring(std::int64_t capacity)
+                : capacity(capacity), items(new std::atomic<T>[std::size_t(capacity)]) {
+            }
+
+            T get(std::int64_t index) const {
+                return items[std::size_t(index & (capacity - 1))].load(std::memory_order_relaxed);
+            }
+
+            void put(std::int64_t index, T item) {
+                items[std::size_t(index & (capacity - 1))].store(item, std::memory_order_relaxed);
+            }
+
+            std::int64_t capacity;
+            std::unique_ptr<std::atomic<T>[]> items;
+        };
+
+    public:
+        explicit work_stealing_deque(std::int64_t capacity = 256)
+            : m_ring(new ring(capacity)) {
+            m_rings.emplace_back(m_ring.load(std::memory_order_relaxed));
+        }
+
+        /**
+         * @brief Push an item at the bottom. Owner thread only.
+         */
+        void push(T item) {
+            const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+            const std::int64_t top = m_top.load(std::memory_order_acquire);
+            ring* array = m_ring.load(std::memory_order_relaxed);
+
+            if (bottom - top > array->capacity - 1) {
+                array = grow(array, top, bottom);
+            }
+
+            array->put(bottom, item);
+            m_bottom.store(bottom + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Pop an item from the bottom. Owner thread only.
+         *
+         * @return True if item has been popped, false if deque is empty.
+         */
+        bool pop(T& item) {
+            const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+            ring* array = m_ring.load(std::memory_order_relaxed);
+            m_bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t top = m_top.load(std::memory_order_relaxed);
+
+            if (top > bottom) {
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            item = array->get(bottom);
+
+            if (top == bottom) {
+                // Last item, race against thieves.
+                const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return won;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Steal an item from the top. Any thread.
+         *
+         * @return True if item has been stolen, false if deque is empty or the race was lost.
+         */
+        bool steal(T& item) {
+            std::int64_t top = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+            if (top >= bottom) {
+                return false;
+            }
+
+            item = m_ring.load(std::memory_order_acquire)->get(top);
+            return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Replace circular array with a twice bigger one. Owner thread only.
+         *        Old arrays are kept alive until destruction, since thieves can still read them.
+         */
+        ring* grow(ring* array, std::int64_t top, std::int64_t bottom) {
+            ring* bigger = m_rings.emplace_back(std::make_unique<ring>(array->capacity * 2)).get();
+
+            for (std::int64_t i = top; i < bottom; ++i) {
+                bigger->put(i, array->get(i));
+            }
+
+            m_ring.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+
+        alignas(64) std::atomic<std::int64_t> m_top = 0;
+        alignas(64) std::atomic<std::int64_t> m_bottom = 0;
+        std::atomic<ring*> m_ring;
+        std::vector<std::unique_ptr<ring>> m_rings;
+    };
+
+    /**
+     * @brief Number of unsuccessful search rounds before worker parks.
+     */
+    constexpr int spin_count = 64;
+
+    /**
+     * @brief Number of task nodes moved at once between thread caches and the shared free list.
+     */
+    constexpr std::size_t cache_batch = 64;
+
+    /**
+     * @brief Number of priority lanes.
+     */
+    constexpr std::size_t lane_count = 3;
+
+    /**
+     * @brief Advance xorshift random generator.
+     */
+    std::uint32_t next_random(std::uint32_t& seed) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+}
+
+struct thread_pool::data {
+    /**
+     * @brief Per-worker state.
+     */
+    struct worker {
+        work_stealing_deque<task*> deques[lane_count];
+
+        std::thread thread;
+    };
+
+    /**
+     * @brief Queues and accounting of a single priority lane.
+     */
+    struct lane {
+        void push_injected(task* node) {
+            std::lock_guard lock(injection_mutex);
+
+            const std::size_t size = injection_size.load(std::memory_order_relaxed);
+            if (size == injection.size()) {
+                // Unwrap circular buffer into a twice bigger one.
+                std::vector<task*> bigger(injection.size() * 2);
+                for (std::size_t i = 0; i < size; ++i) {
+                    bigger[i] = injection[(injection_head + i) % injection.size()];
+                }
+
+                injection = std::move(bigger);
+                injection_head = 0;
+            }
+
+            injection[(injection_head + size) % injection.size()] = node;
+            injection_size.store(size + 1, std::memory_order_relaxed);
+        }
+
+        task* pop_injected() {
+            if (injection_size.load(std::memory_order_relaxed) == 0) {
+                return nullptr;
+            }
+
+            std::lock_guard lock(injection_mutex);
+
+            const std::size_t size = injection_size.load(std::memory_order_relaxed);
+            if (size == 0) {
+                return nullptr;
+            }
+
+            task* node = injection[injection_head];
+            injection_head = (injection_head + 1) % injection.size();
+            injection_size.store(size - 1, std::memory_order_relaxed);
+            return node;
+        }
+
+        std::mutex injection_mutex;
+        std::vector<task*> injection = std::vector<task*>(256);
+        std::size_t injection_head = 0;
+        std::atomic<std::size_t> injection_size = 0;
+
+        /**
+         * @brief Number of queued tasks that did not start yet.
+         */
+        std::atomic<std::size_t> pending = 0;
+
+        /**
+         * @brief Number of workers executing tasks of the lane.
+         */
+        std::atomic<unsigned int> active = 0;
+
+        /**
+         * @brief Maximum number of workers executing tasks of the lane.
+         */
+        std::atomic<unsigned int> limit = 0;
+    };
+
+    /**
+     * @brief Free task nodes shared by all threads.
+     */
+    struct task_heap {
+        ~task_heap() {
+            for (task* node : nodes) {
+                delete node;
+            }
+        }
+
+        std::mutex mutex;
+        std::vector<task*> nodes;
+    };
+
+    /**
+     * @brief Free task nodes owned by a single thread.
+     */
+    struct task_cache {
+        task_cache() {
+            nodes.reserve(cache_batch * 2);
+        }
+
+        ~task_cache() {
+            task_heap& shared = heap();
+
+            std::lock_guard lock(shared.mutex);
+            shared.nodes.insert(shared.nodes.end(), nodes.begin(), nodes.end());
+        }
+
+        std::vector<task*> nodes;
+    };
+
+    static task_heap& heap() {
+        static task_heap heap;
+        return heap;
+    }
+
+    /**
+     * @brief Task nodes cache of the current thread.
+     */
+    static thread_local task_cache cache;
+
+    /**
+     * @brief Pool the current thread is a worker of.
+     */
+    static thread_local data* current;
+
+    /**
+     * @brief Index of the current thread within its pool.
+     */
+    static thread_local std::size_t current_index;
+
+    /**
+     * @brief Random generator state of the current thread used to pick steal victims.
+     */
+    static thread_local std::uint32_t seed;
+
+    std::vector<std::unique_ptr<worker>> workers;
+
+    lane lanes[lane_count];
+
+    std::atomic<unsigned int> sleeping = 0;
+    std::mutex park_mutex;
+    std::condition_variable park;
+
+    std::atomic<bool> running = true;
+
+    bool capped(const lane& lane) const {
+        return lane.limit.load(std::memory_order_relaxed) < workers.size();
+    }
+
+    bool runnable() const {
+        for (const lane& lane : lanes) {
+            if (lane.pending.load(std::memory_order_seq_cst) > 0 && (!capped(lane) || lane.active.load(std::memory_order_relaxed) < lane.limit.load(std::memory_order_relaxed))) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void notify() {
+        if (sleeping.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard lock(park_mutex);
+            park.notify_one();
+        }
+    }
+
+    task* find(std::size_t index) {
+        lane& lane = lanes[index];
+        task* node = nullptr;
+
+        if (lane.pending.load(std::memory_order_relaxed) == 0) {
+            return nullptr;
+        }
+
+        if (current == this && workers[current_index]->deques[index].pop(node)) {
+            return node;
+        }
+
+        if ((node = lane.pop_injected())) {
+            return node;
+        }
+
+        const std::size_t thief = current == this ? current_index : workers.size();
+        const std::size_t count = workers.size();
+        for (std::size_t i = 0, start = count > 0 ? next_random(seed) % count : 0; i < count; ++i) {
+            const std::size_t victim = (start + i) % count;
+            if (victim != thief && workers[victim]->deques[index].steal(node)) {
+                return node;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Tasks also run on threads helping in wait(), so escaping exceptions
+    // terminate there too instead of leaking the node and its counter.
+    void run(lane& lane, task* node) noexcept {
+        lane.pending.fetch_sub(1, std::memory_order_relaxed);
+
+        task_counter* counter = node->counter;
+
+        if (counter && counter->cancelled()) {
+            node->destroy(*node);
+        } else {
+            node->invoke(*node);
+        }
+
+        deallocate(node);
+
+        if (counter) {
+            counter->m_count.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    void drop(task* node) {
+        task_counter* counter = node->counter;
+
+        node->destroy(*node);
+        deallocate(node);
+
+        if (counter) {
+            counter->m_count.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief Execute a single task of the highest priority lane that did not reach its worker limit.
+     *
+     * @return True if a task has been executed, false otherwise.
+     */
+    bool work_once() {
+        for (std::size_t index = 0; index < lane_count; ++index) {
+            lane& lane = lanes[index];
+
+            if (lane.pending.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+
+            const bool reserve = capped(lane);
+            if (reserve && lane.active.fetch_add(1, std::memory_order_acquire) >= lane.limit.load(std::memory_order_relaxed)) {
+                lane.active.fetch_sub(1, std::memory_order_release);
+                continue;
+            }
+
+            task* node = find(index);
+
+            if (node) {
+                run(lane, node);
+            }
+
+            if (reserve) {
+                lane.active.fetch_sub(1, std::memory_order_release);
+
+                // Freed slot can let a parked worker take remaining tasks of the lane.
+                if (node && lane.pending.load(std::memory_order_relaxed) > 0) {
+                    notify();
+                }
+            }
+
+            if (node) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void work(std::size_t index) {
+        current = this;
+        current_index = index;
+        seed = std::uint32_t(index) * 2654435761u + 1u;
+
+        while (running.load(std::memory_order_acquire)) {
+            bool found = work_once();
+
+            for (int i = 0; !found && i < spin_count; ++i) {
+                std::this_thread::yield();
+                found = work_once();
+            }
+
+            if (found) {
+                continue;
+            }
+
+            std::unique_lock lock(park_mutex);
+            sleeping.fetch_add(1, std::memory_order_seq_cst);
+            park.wait(lock, [this] { return !running || runnable(); });
+            sleeping.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+thread_local thread_pool::data::task_cache thread_pool::data::cache;
+thread_local thread_pool::data* thread_pool::data::current = nullptr;
+thread_local std::size_t thread_pool::data::current_index = 0;
+thread_local std::uint32_t thread_pool::data::seed = 2463534242u;
+
 thread_pool::thread_pool(unsigned int thread_count)
-    : m_threads(thread_count) {
-    for (std::thread& thread : m_threads) {
-        thread = std::thread(&thread_pool::worker, this);
+    : m_data(std::make_unique<data>()) {
+    for (unsigned int i = 0; i < thread_count; ++i) {
+        m_data->workers.push_back(std::make_unique<data::worker>());
+    }
+
+    set_thread_limit(task_priority::critical, thread_count);
+    set_thread_limit(task_priority::normal, thread_count);
+    set_thread_limit(task_priority::background, thread_count > 1 ? thread_count - 1 : 1);
+
+    for (std::size_t i = 0; i < m_data->workers.size(); ++i) {
+        m_data->workers[i]->thread = std::thread(&data::work, m_data.get(), i);
     }
 }
 
+thread_pool::thread_pool(thread_pool&&) noexcept = default;
+
+thread_pool& thread_pool::operator=(thread_pool&& thread_pool) noexcept {
+    // Previous workers are stopped by the destructor of the moved-from pool.
+    std::swap(m_data, thread_pool.m_data);
+    return *this;
+}
+
 thread_pool::~thread_pool() {
-    m_running = false;
+    if (!m_data) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_data->park_mutex);
+        m_data->running = false;
+    }
 
-    m_available.notify_all();
+    m_data->park.notify_all();
 
-    for (std::thread& thread : m_threads) {
-        if (thread.joinable()) {
-            thread.join();
+    for (auto& worker : m_data->workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
         }
     }
-}
 
-void thread_pool::worker() {
-    while (m_running) {
-        std::unique_lock lock(m_mutex);
+    // Drop tasks that did not start before shutdown.
+    task* node = nullptr;
+    for (std::size_t index = 0; index < lane_count; ++index) {
+        for (auto& worker : m_data->workers) {
+            while (worker->deques[index].pop(node)) {
+                m_data->drop(node);
+            }
+        }
 
-        m_available.wait(lock, [this] { return !m_tasks.empty() || !m_running; });
+        while ((node = m_data->lanes[index].pop_injected())) {
+            m_data->drop(node);
+        }
+    }
+}
 
-        if (m_running) {
-            std::function<void()> task = std::move(m_tasks.front());
-            m_tasks.pop();
+void thread_pool::wait(const task_counter& counter) {
+    // Background tasks can take long, so helpers skip them unless there is nobody else to run them.
+    const std::size_t helped_lanes = m_data->workers.empty() ? lane_count : std::size_t(task_priority::background);
 
-            lock.unlock();
+    while (!counter.done()) {
+        bool found = false;
 
-            std::invoke(task);
+        for (std::size_t index = 0; index < helped_lanes && !found; ++index) {
+            if (task* node = m_data->find(index); node) {
+                m_data->run(m_data->lanes[index], node);
+                found = true;
+            }
         }
+
+        if (!found) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+unsigned int thread_pool::thread_count() const {
+    return (unsigned int)(m_data->workers.size());
+}
+
+void thread_pool::set_thread_limit(task_priority priority, unsigned int count) {
+    {
+        std::lock_guard lock(m_data->park_mutex);
+        m_data->lanes[std::size_t(priority)].limit.store(std::max(count, 1u), std::memory_order_relaxed);
     }
+
+    m_data->park.notify_all();
+}
+
+unsigned int thread_pool::thread_limit(task_priority priority) const {
+    return m_data->lanes[std::size_t(priority)].limit.load(std::memory_order_relaxed);
+}
+
+thread_pool::task* thread_pool::allocate() {
+    std::vector<task*>& nodes = data::cache.nodes;
+
+    if (nodes.empty()) {
+        data::task_heap& heap = data::heap();
+
+        std::lock_guard lock(heap.mutex);
+        const std::size_t count = std::min(heap.nodes.size(), cache_batch);
+        nodes.insert(nodes.end(), heap.nodes.end() - count, heap.nodes.end());
+        heap.nodes.resize(heap.nodes.size() - count);
+    }
+
+    if (nodes.empty()) {
+        return new task;
+    }
+
+    task* node = nodes.back();
+    nodes.pop_back();
+    return node;
+}
+
+void thread_pool::deallocate(task* node) {
+    std::vector<task*>& nodes = data::cache.nodes;
+
+    nodes.push_back(node);
+
+    if (nodes.size() >= cache_batch * 2) {
+        data::task_heap& heap = data::heap();
+
+        std::lock_guard lock(heap.mutex);
+        heap.nodes.insert(heap.nodes.end(), nodes.end() - cache_batch, nodes.end());
+        nodes.resize(nodes.size() - cache_batch);
+    }
+}
+
+void thread_pool::enqueue(task_priority priority, task* node) {
+    const std::size_t index = std::size_t(priority);
+
+    m_data->lanes[index].pending.fetch_add(1, std::memory_order_seq_cst);
+
+    if (data::current == m_data.get()) {
+        m_data->workers[data::current_index]->deques[index].push(node);
+    } else {
+        m_data->lanes[index].push_injected(node);
+    }
+
+    m_data->notify();
 }
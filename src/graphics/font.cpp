@@ -3,8 +3,110 @@
 #define STB_TRUETYPE_IMPLEMENTATION
 #include <stb_truetype.h>
 
+#include <cstring>
+#include <stdexcept>
+
 using namespace rb;
 
+namespace {
+    /**
+     * @brief Size of glyph atlas in pixels.
+     */
+    constexpr unsigned int atlas_size = 512;
+
+    /**
+     * @brief Cooked font signature, "RBFT".
+     */
+    constexpr std::uint32_t cooked_magic = 0x54464252;
+
+    /**
+     * @brief Cooked font format version.
+     */
+    constexpr std::uint32_t cooked_version = 1;
+
+    /**
+     * @brief Cooked font header, followed by glyphs, font file and atlas pixels.
+     */
+    struct cooked_header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t glyph_count;
+        std::uint32_t font_size;
+    };
+
+    /**
+     * @brief Glyph of cooked font. Glyphs are stored in packing order.
+     */
+    struct cooked_glyph {
+        std::uint32_t codepoint;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::int32_t x;
+        std::int32_t y;
+        float advance;
+        float offset_x;
+        float offset_y;
+    };
+
+    /**
+     * @brief Tell whether data is a single font whose tables lie within data.
+     *        stbtt_InitFont reads tables without checking bounds.
+     */
+    bool is_font(span<const unsigned char> data) {
+        if (data.size() < 16 || stbtt_GetFontOffsetForIndex(data.data(), 0) != 0) {
+            return false;
+        }
+
+        // Table directory follows the 12 bytes long header, each record holds tag, checksum, offset and length.
+        const auto read_u32 = [&data](std::size_t offset) {
+            return std::uint32_t(data[offset]) << 24 | std::uint32_t(data[offset + 1]) << 16 | std::uint32_t(data[offset + 2]) << 8 | data[offset + 3];
+        };
+
+        const std::size_t table_count = std::size_t(data[4]) << 8 | data[5];
+        if (12 + table_count * 16 > data.size()) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < table_count; ++i) {
+            const std::size_t offset = read_u32(12 + i * 16 + 8);
+            const std::size_t length = read_u32(12 + i * 16 + 12);
+            if (offset > data.size() || length > data.size() - offset) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Rasterize glyph into atlas pixels.
+     */
+    glyph rasterize(const stbtt_fontinfo& info, rect_pack& rect_pack, span<color> pixels, unsigned int code_point, unsigned int character_size) {
+        int width, height, xoff, yoff;
+        float scale = stbtt_ScaleForPixelHeight(&info, float(character_size));
+        unsigned char* bitmap = stbtt_GetCodepointBitmap(&info, 0.0f, scale, code_point, &width, &height, &xoff, &yoff);
+        irect rect = rect_pack.pack({ (unsigned int)(width), (unsigned int)(height) });
+
+        for (int y = 0; y < rect.size.y; ++y) {
+            for (int x = 0; x < rect.size.x; ++x) {
+                unsigned int index = (rect.position.y + y) * atlas_size + (rect.position.x + x);
+                pixels[index] = { 255, 255, 255, bitmap[y * rect.size.x + x] };
+            }
+        }
+
+        free(bitmap);
+
+        int advance, lsb;
+        stbtt_GetCodepointHMetrics(&info, code_point, &advance, &lsb);
+
+        glyph glyph;
+        glyph.advance = float(advance) * scale;
+        glyph.offset = { float(xoff), float(yoff) };
+        glyph.rect = rect;
+        return glyph;
+    }
+}
+
 struct font::data {
     stbtt_fontinfo info = {};
     std::vector<unsigned char> font_data;
@@ -12,20 +114,68 @@ struct font::data {
 };
 
 font::font(renderer& renderer, span<const unsigned char> data)
-    : m_texture(renderer, { 512, 512 }, texture_filter::nearest, pixel_format::rgba8)
-    , m_rect_pack({ 512, 512 })
+    : m_texture(renderer, { atlas_size, atlas_size }, texture_filter::nearest, pixel_format::rgba8)
+    , m_rect_pack({ atlas_size, atlas_size })
     , m_data(new font::data()) {
-    // We need to store whole data buffer in memory.
-    m_data->font_data = { data.begin(), data.end() };
+    cooked_header header{};
+    if (data.size() >= sizeof(header)) {
+        std::memcpy(&header, data.data(), sizeof(header));
+    }
 
-    // Initialize font using stored memory buffer.
-    [[maybe_unused]] int result = stbtt_InitFont(&m_data->info, m_data->font_data.data(), 0);
-    assert(result);
+    if (header.magic == cooked_magic) {
+        // Sizes are validated one by one against data size, so corrupted packs cannot overflow offsets.
+        const std::size_t glyphs_offset = sizeof(cooked_header);
+        const std::size_t pixels_size = atlas_size * atlas_size * sizeof(color);
+        if (header.version != cooked_version ||
+            header.glyph_count > (data.size() - glyphs_offset) / sizeof(cooked_glyph) ||
+            header.font_size > data.size() - glyphs_offset - header.glyph_count * sizeof(cooked_glyph) ||
+            data.size() - glyphs_offset - header.glyph_count * sizeof(cooked_glyph) - header.font_size != pixels_size) {
+            throw std::runtime_error("Corrupted cooked font");
+        }
+
+        const std::size_t font_offset = glyphs_offset + header.glyph_count * sizeof(cooked_glyph);
+        const std::size_t pixels_offset = font_offset + header.font_size;
+
+        m_data->font_data = { data.begin() + font_offset, data.begin() + pixels_offset };
+
+        m_data->pixels.resize(atlas_size * atlas_size);
+        std::memcpy(m_data->pixels.data(), data.data() + pixels_offset, m_data->pixels.size() * sizeof(color));
+
+        for (std::uint32_t i = 0; i < header.glyph_count; ++i) {
+            cooked_glyph cooked;
+            std::memcpy(&cooked, data.data() + glyphs_offset + i * sizeof(cooked_glyph), sizeof(cooked));
+
+            // Packing glyphs in the same order restores packer state, so glyphs
+            // rasterized on demand do not overlap cooked ones.
+            if (cooked.width > atlas_size || cooked.height > atlas_size) {
+                throw std::runtime_error("Corrupted cooked font");
+            }
 
-    // Setup initial transparent texture atlas.
-    m_data->pixels.resize(512 * 512);
-    for (std::size_t i = 0; i < 512 * 512; ++i) {
-        m_data->pixels[i] = color::transparent();
+            irect rect = m_rect_pack.pack({ cooked.width, cooked.height });
+            if (rect.position.x != cooked.x || rect.position.y != cooked.y ||
+                rect.end().x > int(atlas_size) || rect.end().y > int(atlas_size)) {
+                throw std::runtime_error("Corrupted cooked font");
+            }
+
+            glyph& glyph = m_glyphs[cooked.codepoint];
+            glyph.advance = cooked.advance;
+            glyph.offset = { cooked.offset_x, cooked.offset_y };
+            glyph.rect = rect;
+        }
+    } else {
+        // We need to store whole data buffer in memory.
+        m_data->font_data = { data.begin(), data.end() };
+
+        // Setup initial transparent texture atlas.
+        m_data->pixels.resize(atlas_size * atlas_size);
+        for (std::size_t i = 0; i < atlas_size * atlas_size; ++i) {
+            m_data->pixels[i] = color::transparent();
+        }
+    }
+
+    // Initialize font using stored memory buffer.
+    if (!is_font(m_data->font_data) || !stbtt_InitFont(&m_data->info, m_data->font_data.data(), 0)) {
+        throw std::runtime_error("Invalid font data");
     }
 
     // Update texture atlas.
@@ -42,34 +192,17 @@ font::font(font&& font) noexcept
 font::~font() = default;
 
 const glyph& font::get_glyph(unsigned int code_point, unsigned int character_size) const {
-    glyph& glyph = m_glyphs[code_point];
-    if (glyph.rect.size.x > 0 && glyph.rect.size.y > 0) {
-        return glyph;
+    // Glyphs without pixels (e.g. space) are cached too, so they are not packed again.
+    if (auto cached = m_glyphs.find(code_point); cached != m_glyphs.end()) {
+        return cached->second;
     }
 
-    int width, height, xoff, yoff;
-    float scale = stbtt_ScaleForPixelHeight(&m_data->info, float(character_size));
-    unsigned char* bitmap = stbtt_GetCodepointBitmap(&m_data->info, 0.0f, scale, code_point, &width, &height, &xoff, &yoff);
-    glyph.advance = 8.0f;
-    irect rect = m_rect_pack.pack({ (unsigned int)(width), (unsigned int)(height) });
-
-    for (int y = 0; y < rect.size.y; ++y) {
-        for (int x = 0; x < rect.size.x; ++x) {
-            unsigned int index = (rect.position.y + y) * 512 + (rect.position.x + x);
-            m_data->pixels[index] = { 255, 255, 255, bitmap[y * rect.size.x + x] };
-        }
-    }
-
-    free(bitmap);
-
-    m_texture.update(m_data->pixels.data());
-
-    int advance, lsb;
-    stbtt_GetCodepointHMetrics(&m_data->info, code_point, &advance, &lsb);
+    glyph& glyph = m_glyphs[code_point];
+    glyph = rasterize(m_data->info, m_rect_pack, m_data->pixels, code_point, character_size);
 
-    glyph.advance = float(advance) * scale;
-    glyph.offset = { float(xoff), float(yoff) };
-    glyph.rect = rect;
+    // Only pixels of the new glyph are uploaded, not the whole atlas.
+    const std::size_t offset = std::size_t(glyph.rect.position.y) * atlas_size + glyph.rect.position.x;
+    m_texture.update(glyph.rect, m_data->pixels.data() + offset, atlas_size * sizeof(color));
     return glyph;
 }
 
@@ -100,3 +233,50 @@ vec2 font::get_text_size(unsigned int character_size, std::string_view text) con
 const texture& font::atlas() const {
     return m_texture;
 }
+
+std::size_t font::memory_size() const {
+    return m_texture.memory_size() + m_data->font_data.size() + m_data->pixels.size() * sizeof(color);
+}
+
+std::vector<std::uint8_t> font::cook(span<const unsigned char> data, unsigned int character_size, span<const unsigned int> codepoints) {
+    stbtt_fontinfo info = {};
+    if (!is_font(data) || !stbtt_InitFont(&info, data.data(), 0)) {
+        throw std::runtime_error("Invalid font data");
+    }
+
+    rect_pack rect_pack({ atlas_size, atlas_size });
+    std::vector<color> pixels(atlas_size * atlas_size, color::transparent());
+    std::vector<cooked_glyph> glyphs;
+
+    for (unsigned int codepoint : codepoints) {
+        const glyph glyph = rasterize(info, rect_pack, pixels, codepoint, character_size);
+
+        glyphs.push_back({
+            codepoint,
+            (std::uint32_t)glyph.rect.size.x,
+            (std::uint32_t)glyph.rect.size.y,
+            glyph.rect.position.x,
+            glyph.rect.position.y,
+            glyph.advance,
+            glyph.offset.x,
+            glyph.offset.y
+        });
+    }
+
+    const cooked_header header{ cooked_magic, cooked_version, (std::uint32_t)glyphs.size(), (std::uint32_t)data.size() };
+
+    std::vector<std::uint8_t> cooked(sizeof(header) + glyphs.size() * sizeof(cooked_glyph) + data.size() + pixels.size() * sizeof(color));
+    std::uint8_t* output = cooked.data();
+
+    std::memcpy(output, &header, sizeof(header));
+    output += sizeof(header);
+
+    std::memcpy(output, glyphs.data(), glyphs.size() * sizeof(cooked_glyph));
+    output += glyphs.size() * sizeof(cooked_glyph);
+
+    std::memcpy(output, data.data(), data.size());
+    output += data.size();
+
+    std::memcpy(output, pixels.data(), pixels.size() * sizeof(color));
+    return cooked;
+}
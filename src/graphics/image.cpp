@@ -4,8 +4,24 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <string>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+
 using namespace rb;
 
+namespace {
+    void fix_alpha(stbi_uc* data, int width, int height) {
+        span<color> pixels((color*)data, std::size_t(width) * height);
+        for (color& pixel : pixels) {
+            if (pixel.a == 0) {
+                pixel.r = pixel.g = pixel.b = 0;
+            }
+        }
+    }
+}
+
 image_info image::info(std::string_view path) {
     int width, height, channels;
     if (stbi_info(std::string(path).c_str(), &width, &height, &channels)) {
@@ -21,20 +37,31 @@ image_info image::info(std::string_view path) {
 image image::from(std::string_view path, bool fix_alpha_border) {
     int width, height, channels;
     stbi_uc* data = stbi_load(std::string(path).c_str(), &width, &height, &channels, 4);
-    assert(data);
+    if (!data) {
+        throw std::runtime_error("Cannot load image " + std::string(path) + ": " + stbi_failure_reason());
+    }
 
     if (fix_alpha_border) {
-        span<color> pixels((color*)data, std::size_t(width) * height);
-        for (color& pixel : pixels) {
-            if (pixel.a == 0) {
-                pixel.r = pixel.g = pixel.b = 0;
-            }
-        }
+        fix_alpha(data, width, height);
     }
 
     return { data, { (unsigned int)width, (unsigned int)height } };
 }
 
+image image::from_memory(span<const std::uint8_t> data, bool fix_alpha_border) {
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load_from_memory(data.data(), (int)data.size(), &width, &height, &channels, 4);
+    if (!pixels) {
+        throw std::runtime_error(std::string("Cannot decode image: ") + stbi_failure_reason());
+    }
+
+    if (fix_alpha_border) {
+        fix_alpha(pixels, width, height);
+    }
+
+    return { pixels, { (unsigned int)width, (unsigned int)height } };
+}
+
 span<const std::uint8_t> image::pixels() const {
     return { m_pixels.get(), std::size_t(m_size.x) * m_size.y * 4 };
 }
@@ -47,6 +74,53 @@ std::size_t image::stride() const {
     return std::size_t(m_size.x) * 4;
 }
 
+image image::downsample() const {
+    const uvec2 size = { std::max(m_size.x / 2, 1u), std::max(m_size.y / 2, 1u) };
+    auto pixels = (unsigned char*)malloc(std::size_t(size.x) * size.y * 4);
+    assert(pixels);
+
+    const std::size_t source_stride = stride();
+    const std::size_t target_stride = std::size_t(size.x) * 4;
+
+    // Pixels of a single pixel wide column are averaged with themselves.
+    const std::size_t next_pixel = m_size.x > 1 ? 4 : 0;
+
+    for (unsigned int y = 0; y < size.y; ++y) {
+        // Single pixel high image averages the row with itself.
+        const unsigned char* row0 = m_pixels.get() + std::size_t(y) * 2 * source_stride;
+        const unsigned char* row1 = m_size.y > 1 ? row0 + source_stride : row0;
+        unsigned char* target = pixels + y * target_stride;
+
+        // Branch free loop over channels, so compilers vectorize it.
+        for (std::size_t i = 0; i < target_stride; ++i) {
+            const std::size_t x = i / 4 * 8 + i % 4;
+            target[i] = (unsigned char)((row0[x] + row0[x + next_pixel] + row1[x] + row1[x + next_pixel] + 2) >> 2);
+        }
+    }
+
+    return { pixels, size };
+}
+
+std::vector<image> image::mipmaps() const {
+    std::vector<image> levels;
+    levels.reserve(mip_count(m_size) - 1);
+
+    for (const image* level = this; level->size().x > 1 || level->size().y > 1; level = &levels.back()) {
+        levels.push_back(level->downsample());
+    }
+
+    return levels;
+}
+
+std::uint32_t image::mip_count(const uvec2& size) {
+    std::uint32_t count = 1;
+    for (unsigned int extent = std::max(size.x, size.y); extent > 1; extent /= 2) {
+        ++count;
+    }
+
+    return count;
+}
+
 image::image(unsigned char* pixels, const uvec2& size)
     : m_pixels(pixels, &free), m_size(size) {
 }
@@ -1,123 +1,286 @@
 #include <rabbit/graphics/s3tc.hpp>
 #include <rabbit/graphics/color.hpp>
+#include <rabbit/core/parallel.hpp>
 
 #include <rgbcx.hpp>
 
 #include <mutex>
+#include <cstring>
+#include <algorithm>
 #include <memory>
 
 using namespace rb;
 
 static std::once_flag s_flag;
 
-static void ensure() {
-	std::call_once(s_flag, [] {
-		rgbcx::init(rgbcx::bc1_approx_mode::cBC1Ideal);
-	});
+static void ensure(s3tc_quality quality) {
+	// Range fit does not use rgbcx tables, so fast encoding does not pay for their initialization.
+	if (quality != s3tc_quality::fast) {
+		std::call_once(s_flag, [] {
+			rgbcx::init(rgbcx::bc1_approx_mode::cBC1Ideal);
+		});
+	}
 }
 
-void s3tc::bc1(const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels) const {
-	ensure();
-
-	struct block {
-		color colors[2];
-	};
-
+template<std::size_t BlockSize, typename Encode>
+static void encode_rows(const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels, std::size_t first_row, std::size_t last_row, Encode encode) {
 	const auto pixels = reinterpret_cast<const color*>(uncompressed_pixels);
-	const auto blocks = reinterpret_cast<block*>(compressed_pixels);
+	const auto blocks = reinterpret_cast<std::uint8_t*>(compressed_pixels);
 
 	color input_block[16];
 
 	const auto size_x = stride / 4;
-	const auto blocks_x = size_x / 4;
 	const auto size_y = uncompressed_size / stride;
+	const auto blocks_x = (size_x + 3) / 4;
+
+	for (auto by = first_row; by < last_row; ++by) {
+		for (auto bx = std::size_t(0); bx < blocks_x; ++bx) {
+			const auto x = bx * 4;
 
-	for (auto y = 0u; y < size_y; y += 4) {
-		for (auto x = 0u; x < size_x; x += 4) {
-			input_block[0] = pixels[y * size_x + x];
-			input_block[1] = pixels[y * size_x + x + 1];
-			input_block[2] = pixels[y * size_x + x + 2];
-			input_block[3] = pixels[y * size_x + x + 3];
+			// Blocks of images smaller than a block (e.g. last mipmap levels) repeat edge pixels.
+			for (auto row = 0u; row < 4; ++row) {
+				const auto source = pixels + std::min(by * 4 + row, size_y - 1) * size_x;
+
+				input_block[row * 4] = source[std::min(x, size_x - 1)];
+				input_block[row * 4 + 1] = source[std::min(x + 1, size_x - 1)];
+				input_block[row * 4 + 2] = source[std::min(x + 2, size_x - 1)];
+				input_block[row * 4 + 3] = source[std::min(x + 3, size_x - 1)];
+			}
+
+			encode(blocks + (by * blocks_x + bx) * BlockSize, (const std::uint8_t*)&input_block);
+		}
+	}
+}
 
-			input_block[4] = pixels[(y + 1) * size_x + x];
-			input_block[5] = pixels[(y + 1) * size_x + x + 1];
-			input_block[6] = pixels[(y + 1) * size_x + x + 2];
-			input_block[7] = pixels[(y + 1) * size_x + x + 3];
+template<std::size_t BlockSize, typename Encode>
+static void encode_rows(thread_pool& pool, const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels, const s3tc::progress_callback& progress, Encode encode) {
+	const auto block_rows = (uncompressed_size / stride + 3) / 4;
+	const auto band_rows = parallel_grain(pool, block_rows);
+	const auto band_count = (block_rows + band_rows - 1) / band_rows;
 
-			input_block[8] = pixels[(y + 2) * size_x + x];
-			input_block[9] = pixels[(y + 2) * size_x + x + 1];
-			input_block[10] = pixels[(y + 2) * size_x + x + 2];
-			input_block[11] = pixels[(y + 3) * size_x + x + 3];
+	std::mutex progress_mutex;
+	std::size_t encoded_rows = 0;
 
-			input_block[12] = pixels[(y + 3) * size_x + x];
-			input_block[13] = pixels[(y + 3) * size_x + x + 1];
-			input_block[14] = pixels[(y + 3) * size_x + x + 2];
-			input_block[15] = pixels[(y + 3) * size_x + x + 3];
+	// Every band writes its own range of blocks, so the output does not depend on scheduling.
+	parallel_for(pool, std::size_t(0), band_count, 1, [&](std::size_t band) {
+		const auto first_row = band * band_rows;
+		const auto last_row = std::min(first_row + band_rows, block_rows);
 
-			const auto by = y / 4;
-			const auto bx = x / 4;
+		encode_rows<BlockSize>(uncompressed_pixels, uncompressed_size, stride, compressed_pixels, first_row, last_row, encode);
 
-			rgbcx::encode_bc1(&blocks[by * blocks_x + bx], (const std::uint8_t*)&input_block);
+		if (progress) {
+			std::lock_guard lock(progress_mutex);
+			encoded_rows += last_row - first_row;
+			progress(encoded_rows, block_rows);
 		}
-	}
+	});
 }
 
-void s3tc::bc3(const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels) const {
-	ensure();
+static std::uint16_t pack_565(int r, int g, int b) {
+	return std::uint16_t(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
 
-	struct block {
-		color colors[4];
-	};
+static void unpack_565(std::uint16_t color, int* channels) {
+	const int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
 
-	const auto pixels = reinterpret_cast<const color*>(uncompressed_pixels);
-	const auto blocks = reinterpret_cast<block*>(compressed_pixels);
+	channels[0] = (r << 3) | (r >> 2);
+	channels[1] = (g << 2) | (g >> 4);
+	channels[2] = (b << 3) | (b >> 2);
+}
 
-	color input_block[16];
+// Range fit: endpoints are the block bounding box inset by 1/16 of its size and selectors
+// are projections on the diagonal. Fixed length integer loops without branches, so compilers
+// vectorize them.
+static void encode_bc1_range_fit(void* block, const std::uint8_t* pixels) {
+	int min[3] = { 255, 255, 255 }, max[3] = { 0, 0, 0 };
 
-	const auto size_x = stride / 4;
-	const auto blocks_x = size_x / 4;
-	const auto size_y = uncompressed_size / stride;
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			min[c] = std::min<int>(min[c], pixels[i * 4 + c]);
+			max[c] = std::max<int>(max[c], pixels[i * 4 + c]);
+		}
+	}
+
+	for (int c = 0; c < 3; ++c) {
+		const int inset = (max[c] - min[c]) >> 4;
+		min[c] += inset;
+		max[c] -= inset;
+	}
 
-	for (auto y = 0u; y < size_y; y += 4) {
-		for (auto x = 0u; x < size_x; x += 4) {
-			input_block[0] = pixels[y * size_x + x];
-			input_block[1] = pixels[y * size_x + x + 1];
-			input_block[2] = pixels[y * size_x + x + 2];
-			input_block[3] = pixels[y * size_x + x + 3];
+	std::uint16_t color0 = pack_565(max[0], max[1], max[2]);
+	std::uint16_t color1 = pack_565(min[0], min[1], min[2]);
 
-			input_block[4] = pixels[(y + 1) * size_x + x];
-			input_block[5] = pixels[(y + 1) * size_x + x + 1];
-			input_block[6] = pixels[(y + 1) * size_x + x + 2];
-			input_block[7] = pixels[(y + 1) * size_x + x + 3];
+	// Four color mode requires color0 > color1. Selectors are computed from the swapped endpoints.
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	int end0[3], end1[3], axis[3];
+	unpack_565(color0, end0);
+	unpack_565(color1, end1);
 
-			input_block[8] = pixels[(y + 2) * size_x + x];
-			input_block[9] = pixels[(y + 2) * size_x + x + 1];
-			input_block[10] = pixels[(y + 2) * size_x + x + 2];
-			input_block[11] = pixels[(y + 3) * size_x + x + 3];
+	for (int c = 0; c < 3; ++c) {
+		axis[c] = end0[c] - end1[c];
+	}
 
-			input_block[12] = pixels[(y + 3) * size_x + x];
-			input_block[13] = pixels[(y + 3) * size_x + x + 1];
-			input_block[14] = pixels[(y + 3) * size_x + x + 2];
-			input_block[15] = pixels[(y + 3) * size_x + x + 3];
+	const int length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
 
-			const auto by = y / 4;
-			const auto bx = x / 4;
+	// Position 0 is color1, position 3 is color0, BC1 orders them 1, 3, 2, 0.
+	constexpr std::uint32_t selector_order[4] = { 1, 3, 2, 0 };
 
-			rgbcx::encode_bc3(&blocks[by * blocks_x + bx], (const std::uint8_t*)&input_block);
+	std::uint32_t selectors = 0;
+	if (length > 0) {
+		const float scale = 3.0f / float(length);
+
+		for (int i = 0; i < 16; ++i) {
+			const int dot = (pixels[i * 4] - end1[0]) * axis[0] + (pixels[i * 4 + 1] - end1[1]) * axis[1] + (pixels[i * 4 + 2] - end1[2]) * axis[2];
+			const int position = std::clamp(int(float(dot) * scale + 0.5f), 0, 3);
+			selectors |= selector_order[position] << (i * 2);
 		}
 	}
+
+	// Equal endpoints are three color mode, selector 0 picks color0 in both modes.
+	if (color0 == color1) {
+		selectors = 0;
+	}
+
+	auto bytes = static_cast<std::uint8_t*>(block);
+	std::memcpy(bytes, &color0, 2);
+	std::memcpy(bytes + 2, &color1, 2);
+	std::memcpy(bytes + 4, &selectors, 4);
+}
+
+// Alpha counterpart of range fit with eight interpolated values between min and max.
+static void encode_bc4_range_fit(void* block, const std::uint8_t* pixels) {
+	int min = 255, max = 0;
+
+	for (int i = 0; i < 16; ++i) {
+		min = std::min<int>(min, pixels[i * 4]);
+		max = std::max<int>(max, pixels[i * 4]);
+	}
+
+	const int range = max - min;
+
+	// Position 0 is alpha1 (min), position 7 is alpha0 (max), BC4 orders them 1, 7, 6, 5, 4, 3, 2, 0.
+	constexpr std::uint64_t index_order[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+
+	std::uint64_t indices = 0;
+	if (range > 0) {
+		const float scale = 7.0f / float(range);
+
+		for (int i = 0; i < 16; ++i) {
+			const int position = int(float(pixels[i * 4] - min) * scale + 0.5f);
+			indices |= index_order[position] << (i * 3);
+		}
+	}
+
+	auto bytes = static_cast<std::uint8_t*>(block);
+	bytes[0] = std::uint8_t(max);
+	bytes[1] = std::uint8_t(min);
+
+	for (int i = 0; i < 6; ++i) {
+		bytes[2 + i] = std::uint8_t(indices >> (i * 8));
+	}
+}
+
+static void encode_bc1_fast(void* block, const std::uint8_t* pixels) {
+	encode_bc1_range_fit(block, pixels);
+}
+
+static void encode_bc1_normal(void* block, const std::uint8_t* pixels) {
+	rgbcx::encode_bc1(block, pixels);
+}
+
+static void encode_bc1_best(void* block, const std::uint8_t* pixels) {
+	// Transparent texels are not used for black, so alpha stays opaque when sampled.
+	rgbcx::encode_bc1(10, block, pixels, true, false);
+}
+
+static void encode_bc3_fast(void* block, const std::uint8_t* pixels) {
+	encode_bc4_range_fit(block, pixels + 3);
+	encode_bc1_range_fit(static_cast<std::uint8_t*>(block) + 8, pixels);
+}
+
+static void encode_bc3_normal(void* block, const std::uint8_t* pixels) {
+	rgbcx::encode_bc3(block, pixels);
+}
+
+static void encode_bc3_best(void* block, const std::uint8_t* pixels) {
+	rgbcx::encode_bc3(10, block, pixels);
+}
+
+static std::size_t block_count(const image& image) {
+	return std::size_t((image.size().x + 3) / 4) * ((image.size().y + 3) / 4);
+}
+
+using encode_function = void (*)(void*, const std::uint8_t*);
+
+static encode_function bc1_encoder(s3tc_quality quality) {
+	switch (quality) {
+		case s3tc_quality::fast: return encode_bc1_fast;
+		case s3tc_quality::best: return encode_bc1_best;
+		default: return encode_bc1_normal;
+	}
+}
+
+static encode_function bc3_encoder(s3tc_quality quality) {
+	switch (quality) {
+		case s3tc_quality::fast: return encode_bc3_fast;
+		case s3tc_quality::best: return encode_bc3_best;
+		default: return encode_bc3_normal;
+	}
+}
+
+s3tc::s3tc(s3tc_quality quality)
+	: m_quality(quality) {
+}
+
+s3tc_quality s3tc::quality() const {
+	return m_quality;
+}
+
+void s3tc::bc1(const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels) const {
+	ensure(m_quality);
+	encode_rows<8>(uncompressed_pixels, uncompressed_size, stride, compressed_pixels, 0, (uncompressed_size / stride + 3) / 4, bc1_encoder(m_quality));
+}
+
+void s3tc::bc3(const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels) const {
+	ensure(m_quality);
+	encode_rows<16>(uncompressed_pixels, uncompressed_size, stride, compressed_pixels, 0, (uncompressed_size / stride + 3) / 4, bc3_encoder(m_quality));
 }
 
 std::vector<std::uint8_t> s3tc::bc1(const image& image) const {
-	const auto compressed_size = (image.size().x * image.size().y) / 2;
+	const auto compressed_size = block_count(image) * 8;
 	auto compressed_pixels = std::make_unique<std::uint8_t[]>(compressed_size);
 	bc1(image.pixels().data(), image.pixels().size_bytes(), image.stride(), compressed_pixels.get());
 	return { compressed_pixels.get(), compressed_pixels.get() + compressed_size };
 }
 
 std::vector<std::uint8_t> s3tc::bc3(const image& image) const {
-	const auto compressed_size = (image.size().x * image.size().y);
+	const auto compressed_size = block_count(image) * 16;
 	auto compressed_pixels = std::make_unique<std::uint8_t[]>(compressed_size);
 	bc3(image.pixels().data(), image.pixels().size_bytes(), image.stride(), compressed_pixels.get());
 	return { compressed_pixels.get(), compressed_pixels.get() + compressed_size };
-}
\ No newline at end of file
+}
+
+void s3tc::bc1(thread_pool& pool, const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels, const progress_callback& progress) const {
+	ensure(m_quality);
+	encode_rows<8>(pool, uncompressed_pixels, uncompressed_size, stride, compressed_pixels, progress, bc1_encoder(m_quality));
+}
+
+void s3tc::bc3(thread_pool& pool, const void* uncompressed_pixels, std::size_t uncompressed_size, std::size_t stride, void* compressed_pixels, const progress_callback& progress) const {
+	ensure(m_quality);
+	encode_rows<16>(pool, uncompressed_pixels, uncompressed_size, stride, compressed_pixels, progress, bc3_encoder(m_quality));
+}
+
+std::vector<std::uint8_t> s3tc::bc1(thread_pool& pool, const image& image, const progress_callback& progress) const {
+	std::vector<std::uint8_t> compressed_pixels(block_count(image) * 8);
+	bc1(pool, image.pixels().data(), image.pixels().size_bytes(), image.stride(), compressed_pixels.data(), progress);
+	return compressed_pixels;
+}
+
+std::vector<std::uint8_t> s3tc::bc3(thread_pool& pool, const image& image, const progress_callback& progress) const {
+	std::vector<std::uint8_t> compressed_pixels(block_count(image) * 16);
+	bc3(pool, image.pixels().data(), image.pixels().size_bytes(), image.stride(), compressed_pixels.data(), progress);
+	return compressed_pixels;
+}
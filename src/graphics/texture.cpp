@@ -1,9 +1,30 @@
 #include <rabbit/graphics/texture.hpp>
 
+#include <algorithm>
+
 using namespace rb;
 
-texture::texture(renderer& renderer, const uvec2& size, texture_filter filter, pixel_format format)
-    : m_renderer(renderer), m_id(renderer.create_texture(size, filter, format)) {
+namespace {
+    std::size_t bytes_per_pixel(pixel_format format) {
+        switch (format) {
+            case pixel_format::r8: return 1;
+            case pixel_format::rg8: return 2;
+            case pixel_format::rgba8: return 4;
+            default: return 0;
+        }
+    }
+
+    std::size_t bytes_per_block(pixel_format format) {
+        switch (format) {
+            case pixel_format::bc1: return 8;
+            case pixel_format::bc3: return 16;
+            default: return 0;
+        }
+    }
+}
+
+texture::texture(renderer& renderer, const uvec2& size, texture_filter filter, pixel_format format, std::uint32_t mip_count)
+    : m_renderer(renderer), m_id(renderer.create_texture(size, filter, format, mip_count)) {
 }
 
 texture::texture(texture&& texture) noexcept
@@ -25,6 +46,10 @@ void texture::update(const void* pixels) {
     m_renderer.update_texture_data(m_id, pixels);
 }
 
+void texture::update(const irect& rect, const void* pixels, std::size_t stride) {
+    m_renderer.update_texture_region(m_id, rect, pixels, stride);
+}
+
 bool texture::valid() const {
     // We don't need to check that handle is valid within renderer.
     // We assume that once created handle in the constructor
@@ -43,3 +68,32 @@ uvec2 texture::size() const {
 pixel_format texture::format() const {
     return m_renderer.get_texture_format(m_id);
 }
+
+std::uint32_t texture::mip_count() const {
+    return m_renderer.get_texture_mip_count(m_id);
+}
+
+std::size_t texture::memory_size() const {
+    return memory_size(size(), format(), mip_count());
+}
+
+std::size_t texture::memory_size(const uvec2& size, pixel_format format, std::uint32_t mip_count) {
+    std::size_t memory_size = 0;
+
+    for (std::uint32_t level = 0; level < mip_count; ++level) {
+        const uvec2 level_size = texture::level_size(size, level);
+
+        // Block compressed levels smaller than a block still take a whole block.
+        if (const std::size_t block = bytes_per_block(format); block > 0) {
+            memory_size += std::size_t((level_size.x + 3) / 4) * ((level_size.y + 3) / 4) * block;
+        } else {
+            memory_size += std::size_t(level_size.x) * level_size.y * bytes_per_pixel(format);
+        }
+    }
+
+    return memory_size;
+}
+
+uvec2 texture::level_size(const uvec2& size, std::uint32_t level) {
+    return { std::max(size.x >> level, 1u), std::max(size.y >> level, 1u) };
+}
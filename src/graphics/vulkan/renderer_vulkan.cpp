@@ -12,10 +12,10 @@ renderer::~renderer() {
     vku::quit(m_data);
 }
 
-handle renderer::create_texture(const uvec2& size, texture_filter filter, pixel_format format) {
+handle renderer::create_texture(const uvec2& size, texture_filter filter, pixel_format format, std::uint32_t mip_count) {
     handle id = m_data->textures.create();
 
-    m_data->textures[id] = vku::create_texture(m_data, size, filter, format);
+    m_data->textures[id] = vku::create_texture(m_data, size, filter, format, mip_count);
 
     return id;
 }
@@ -23,6 +23,8 @@ handle renderer::create_texture(const uvec2& size, texture_filter filter, pixel_
 void renderer::destroy_texture(handle id) {
     assert(m_data->textures.valid(id));
 
+    vku::discard_texture_uploads(m_data, id);
+
     m_data->textures_to_delete.push(m_data->textures[id]);
     m_data->textures[id] = {};
     // vku::cleanup_texture(m_data, m_data->textures[id]);
@@ -33,23 +35,21 @@ void renderer::destroy_texture(handle id) {
 void renderer::update_texture_data(handle id, const void* pixels) {
     assert(m_data->textures.valid(id));
 
-    texture_data& texture = m_data->textures[id];
+    vku::update_texture(m_data, id, pixels);
+    vku::update_texture_descriptor(m_data, id);
+}
 
-    vku::update_texture(m_data, texture, pixels);
+void renderer::update_texture_region(handle id, const irect& rect, const void* pixels, std::size_t stride) {
+    assert(m_data->textures.valid(id));
 
-    VkDescriptorImageInfo descriptor_image_info{};
-    descriptor_image_info.sampler = texture.sampler;
-    descriptor_image_info.imageView = texture.image_view;
-    descriptor_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    // Textures updated only by regions are not bound until their first upload.
+    const bool initialized = m_data->textures[id].initialized;
 
-    VkWriteDescriptorSet write_info{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-    write_info.dstSet = m_data->main_descriptor_set;
-    write_info.dstBinding = 0;
-    write_info.dstArrayElement = std::uint32_t(id);
-    write_info.descriptorCount = 1;
-    write_info.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write_info.pImageInfo = &descriptor_image_info;
-    vkUpdateDescriptorSets(m_data->device, 1, &write_info, 0, nullptr);
+    vku::stage_texture_region(m_data, id, rect, pixels, stride);
+
+    if (!initialized && m_data->textures[id].initialized) {
+        vku::update_texture_descriptor(m_data, id);
+    }
 }
 
 bool renderer::is_texture_valid(handle id) const {
@@ -68,6 +68,12 @@ pixel_format renderer::get_texture_format(handle id) const {
     return m_data->textures[id].format;
 }
 
+std::uint32_t renderer::get_texture_mip_count(handle id) const {
+    assert(m_data->textures.valid(id));
+
+    return m_data->textures[id].mip_count;
+}
+
 void renderer::draw(handle texture_id, span<const vertex2d> vertices, span<const unsigned int> indices) {
     void* ptr;
 
@@ -80,7 +86,7 @@ void renderer::draw(handle texture_id, span<const vertex2d> vertices, span<const
     vmaUnmapMemory(m_data->allocator, m_data->canvas_index_buffer_allocation);
 
     draw_data command;
-    command.texture_index = texture_id == null ? -1 : int(texture_id);
+    command.texture_index = texture_id == null ? -1 : int(handle_index(texture_id));
     command.index_offset = m_data->canvas_index_buffer_offset;
     command.index_count = (unsigned int)(indices.size());
     command.vertex_offset = m_data->canvas_vertex_buffer_offset;
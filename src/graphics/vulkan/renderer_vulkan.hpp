@@ -6,6 +6,7 @@
 #include <volk.h>
 #include <vma/vk_mem_alloc.h>
 
+#include <deque>
 #include <vector>
 #include <queue>
 
@@ -17,6 +18,29 @@ namespace rb {
         VkSampler sampler = VK_NULL_HANDLE;
         uvec2 size = { 0, 0 };
         pixel_format format = pixel_format::undefined;
+        uint32_t mip_count = 1;
+        bool initialized = false;
+    };
+
+    struct texture_upload {
+        handle texture_id = null;
+        bool whole = false;
+        VkBufferImageCopy copy = {};
+    };
+
+    struct upload_batch {
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkDeviceSize staging_end = 0;
+    };
+
+    struct staging_ring {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        uint8_t* mapped = nullptr;
+        VkDeviceSize size = 0;
+        VkDeviceSize head = 0;
+        VkDeviceSize tail = 0;
     };
 
     struct draw_data {
@@ -76,9 +100,14 @@ namespace rb {
         VkPipeline pipeline;
 
 
-        arena<texture_data> textures;
+        arena<texture_data, 64> textures;
         std::queue<texture_data> textures_to_delete;
 
+        staging_ring staging;
+        std::vector<texture_upload> texture_uploads;
+        std::deque<upload_batch> upload_batches;
+        std::vector<upload_batch> free_upload_batches;
+
         std::vector<draw_data> draw_commands;
     };
 }
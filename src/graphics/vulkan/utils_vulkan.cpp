@@ -1,5 +1,7 @@
 #include "utils_vulkan.hpp"
 
+#include <rabbit/graphics/texture.hpp>
+
 #include "shaders/gen/canvas.vert.spv.h"
 #include "shaders/gen/canvas.frag.spv.h"
 
@@ -7,9 +9,15 @@
 #include <vma/vk_mem_alloc.h>
 
 #include <cstdio>
+#include <algorithm>
 
 using namespace rb;
 
+/**
+ * @brief Initial size of the staging ring, grows for larger uploads.
+ */
+static constexpr VkDeviceSize staging_ring_size = 16 * 1024 * 1024;
+
 #if _DEBUG
 static const char* validation_layers[] = {
     "VK_LAYER_KHRONOS_validation"
@@ -108,6 +116,9 @@ void vku::setup(std::unique_ptr<renderer::data>& data, window& window) {
         }
     }
 
+    // Software implementations (e.g. lavapipe) have a single family for both graphics and present.
+    data->present_family = data->graphics_family;
+
     for (std::uint32_t i = 0; i < queue_family_count; ++i) {
         VkBool32 present_support = VK_FALSE;
         vkGetPhysicalDeviceSurfaceSupportKHR(data->physical_device, i, data->surface, &present_support);
@@ -163,7 +174,7 @@ void vku::setup(std::unique_ptr<renderer::data>& data, window& window) {
     device_info.ppEnabledExtensionNames = device_extensions;
     // device_info.pEnabledFeatures = &supported_features;
     device_info.pEnabledFeatures = nullptr;
-    device_info.queueCreateInfoCount = sizeof(device_queue_infos) / sizeof(*device_queue_infos);
+    device_info.queueCreateInfoCount = data->graphics_family != data->present_family ? 2 : 1;
     device_info.pQueueCreateInfos = device_queue_infos;
 
     // Create new Vulkan logical device using physical one.
@@ -386,6 +397,8 @@ void vku::setup(std::unique_ptr<renderer::data>& data, window& window) {
         vk(vkCreateFence(data->device, &fence_info, nullptr, &fence));
     }
 
+    create_staging_ring(data, staging_ring_size);
+
 
     VkBufferCreateInfo canvas_vertex_buffer_info{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
     canvas_vertex_buffer_info.size = sizeof(vertex2d) * 0x10000;
@@ -632,6 +645,16 @@ void vku::quit(std::unique_ptr<renderer::data>& data) {
 
     cleanup(data);
 
+    for (const upload_batch& batch : data->upload_batches) {
+        vkDestroyFence(data->device, batch.fence, nullptr);
+    }
+
+    for (const upload_batch& batch : data->free_upload_batches) {
+        vkDestroyFence(data->device, batch.fence, nullptr);
+    }
+
+    cleanup_staging_ring(data);
+
     data->textures.each([&data](handle id, texture_data& texture) {
         cleanup_texture(data, texture);
     });
@@ -677,6 +700,11 @@ void vku::cleanup(std::unique_ptr<renderer::data>& data) {
 }
 
 void vku::begin(std::unique_ptr<renderer::data>& data) {
+    // Uploads staged since the last frame are submitted ahead of it. Finished batches free their staging memory.
+    submit_uploads(data);
+    while (retire_upload_batch(data, false)) {
+    }
+
     vk(vkAcquireNextImageKHR(data->device, data->swapchain, UINT64_MAX, data->present_semaphore, VK_NULL_HANDLE, &data->image_index));
 
     vkWaitForFences(data->device, 1, &data->fences[data->image_index], VK_FALSE, UINT64_MAX);
@@ -751,14 +779,14 @@ VkFilter vku::get_filter(texture_filter filter) {
     return VK_FILTER_MAX_ENUM;
 }
 
-texture_data vku::create_texture(std::unique_ptr<renderer::data>& data, const uvec2& size, texture_filter filter, pixel_format format) {
+texture_data vku::create_texture(std::unique_ptr<renderer::data>& data, const uvec2& size, texture_filter filter, pixel_format format, uint32_t mip_count) {
     texture_data texture;
 
     VkImageCreateInfo image_info{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
     image_info.imageType = VK_IMAGE_TYPE_2D;
     image_info.format = get_pixel_format(format);
     image_info.extent = { size.x, size.y, 1 };
-    image_info.mipLevels = 1;
+    image_info.mipLevels = mip_count;
     image_info.arrayLayers = 1;
     image_info.samples = VK_SAMPLE_COUNT_1_BIT;
     image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -782,7 +810,7 @@ texture_data vku::create_texture(std::unique_ptr<renderer::data>& data, const uv
     image_view_info.components.a = VK_COMPONENT_SWIZZLE_A;
     image_view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     image_view_info.subresourceRange.baseMipLevel = 0;
-    image_view_info.subresourceRange.levelCount = 1;
+    image_view_info.subresourceRange.levelCount = mip_count;
     image_view_info.subresourceRange.baseArrayLayer = 0;
     image_view_info.subresourceRange.layerCount = 1;
     vk(vkCreateImageView(data->device, &image_view_info, nullptr, &texture.image_view));
@@ -790,7 +818,7 @@ texture_data vku::create_texture(std::unique_ptr<renderer::data>& data, const uv
     VkSamplerCreateInfo sampler_info{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
     sampler_info.magFilter = get_filter(filter);
     sampler_info.minFilter = sampler_info.magFilter;
-    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler_info.mipmapMode = filter == texture_filter::nearest ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
     sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     sampler_info.addressModeV = sampler_info.addressModeU;
     sampler_info.addressModeW = sampler_info.addressModeV;
@@ -800,114 +828,331 @@ texture_data vku::create_texture(std::unique_ptr<renderer::data>& data, const uv
     sampler_info.compareEnable = VK_FALSE;
     sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
     sampler_info.minLod = 0.0f;
-    sampler_info.maxLod = 1.0f;
+    sampler_info.maxLod = float(mip_count);
     sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     sampler_info.unnormalizedCoordinates = VK_FALSE;
     vk(vkCreateSampler(data->device, &sampler_info, nullptr, &texture.sampler));
 
     texture.size = size;
     texture.format = format;
+    texture.mip_count = mip_count;
     return texture;
 }
 
-void vku::update_texture(std::unique_ptr<renderer::data>& data, texture_data& texture, const void* pixels) {
-    // Create staging buffer.
+void vku::create_staging_ring(std::unique_ptr<renderer::data>& data, VkDeviceSize size) {
     VkBufferCreateInfo buffer_info{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-    buffer_info.size = VkDeviceSize(texture.size.x) * texture.size.y * get_bits_per_pixel(texture.format) / 8;
+    buffer_info.size = size;
     buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
     buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     buffer_info.queueFamilyIndexCount = 0;
     buffer_info.pQueueFamilyIndices = nullptr;
 
     VmaAllocationCreateInfo buffer_allocation_info{};
-    buffer_allocation_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    buffer_allocation_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    buffer_allocation_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo allocation_info;
+    vk(vmaCreateBuffer(data->allocator, &buffer_info, &buffer_allocation_info, &data->staging.buffer, &data->staging.allocation, &allocation_info));
+
+    data->staging.mapped = static_cast<uint8_t*>(allocation_info.pMappedData);
+    data->staging.size = size;
+    data->staging.head = 0;
+    data->staging.tail = 0;
+}
+
+VkDeviceSize vku::allocate_staging(std::unique_ptr<renderer::data>& data, VkDeviceSize size) {
+    staging_ring& ring = data->staging;
+
+    // Buffer offsets of copies must be multiple of 4 and of the block size.
+    size = (size + 15) & ~VkDeviceSize(15);
+
+    while (true) {
+        if (data->texture_uploads.empty() && data->upload_batches.empty()) {
+            // Nothing uses the ring, so it starts over. It only grows for uploads larger than the whole ring.
+            if (size > ring.size) {
+                const VkDeviceSize ring_size = std::max(size, ring.size * 2);
+                cleanup_staging_ring(data);
+                create_staging_ring(data, ring_size);
+            }
+
+            ring.head = ring.tail = 0;
+        }
+
+        // Used part of the ring spans from tail to head, wrapping at the end.
+        // Head never catches up with tail, so equal offsets always mean empty ring.
+        if (ring.tail <= ring.head) {
+            if (ring.head + size <= ring.size) {
+                ring.head += size;
+                return ring.head - size;
+            }
+
+            if (size < ring.tail) {
+                ring.head = size;
+                return 0;
+            }
+        } else if (ring.head + size < ring.tail) {
+            ring.head += size;
+            return ring.head - size;
+        }
+
+        // Ring is full. Pending uploads are submitted, so they can be waited for.
+        if (!data->texture_uploads.empty()) {
+            submit_uploads(data);
+        }
+
+        retire_upload_batch(data, true);
+    }
+}
+
+void vku::update_texture(std::unique_ptr<renderer::data>& data, handle id, const void* pixels) {
+    texture_data& texture = data->textures[id];
+    texture.initialized = true;
+
+    // Whole texture is replaced, so pending uploads would only overwrite new pixels.
+    discard_texture_uploads(data, id);
+
+    // All mipmap levels are copied from a single staging allocation.
+    // Buffer offsets of copies must be multiple of 4, so small levels are padded.
+    std::vector<texture_upload> uploads(texture.mip_count);
+    VkDeviceSize staging_size = 0;
+
+    for (uint32_t level = 0; level < texture.mip_count; ++level) {
+        const uvec2 level_size = rb::texture::level_size(texture.size, level);
+
+        texture_upload& upload = uploads[level];
+        upload.texture_id = id;
+        upload.whole = true;
+        upload.copy.bufferOffset = staging_size;
+        upload.copy.bufferRowLength = 0;
+        upload.copy.bufferImageHeight = 0;
+        upload.copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        upload.copy.imageSubresource.mipLevel = level;
+        upload.copy.imageSubresource.baseArrayLayer = 0;
+        upload.copy.imageSubresource.layerCount = 1;
+        upload.copy.imageOffset = { 0, 0, 0 };
+        upload.copy.imageExtent = { level_size.x, level_size.y, 1 };
+
+        staging_size = (staging_size + rb::texture::memory_size(level_size, texture.format) + 3) & ~VkDeviceSize(3);
+    }
+
+    // Transfer pixels of all levels into the ring.
+    const VkDeviceSize offset = allocate_staging(data, staging_size);
+
+    auto source = static_cast<const uint8_t*>(pixels);
+    for (texture_upload& upload : uploads) {
+        const size_t level_size = rb::texture::memory_size({ upload.copy.imageExtent.width, upload.copy.imageExtent.height }, texture.format);
+        memcpy(data->staging.mapped + offset + upload.copy.bufferOffset, source, level_size);
+        source += level_size;
 
-    VkBuffer staging_buffer;
-    VmaAllocation staging_buffer_allocation;
-    vk(vmaCreateBuffer(data->allocator, &buffer_info, &buffer_allocation_info, &staging_buffer, &staging_buffer_allocation, nullptr));
+        upload.copy.bufferOffset += offset;
+        data->texture_uploads.push_back(upload);
+    }
+}
+
+void vku::stage_texture_region(std::unique_ptr<renderer::data>& data, handle id, const irect& rect, const void* pixels, size_t stride) {
+    texture_data& texture = data->textures[id];
+    assert(rect.position.x >= 0 && rect.position.y >= 0);
+    assert(rect.end().x <= int(texture.size.x) && rect.end().y <= int(texture.size.y));
+    assert((texture.format != pixel_format::bc1 && texture.format != pixel_format::bc3) ||
+        (rect.position.x % 4 == 0 && rect.position.y % 4 == 0 &&
+        (rect.size.x % 4 == 0 || rect.end().x == int(texture.size.x)) &&
+        (rect.size.y % 4 == 0 || rect.end().y == int(texture.size.y))));
+
+    if (rect.size.x <= 0 || rect.size.y <= 0) {
+        return;
+    }
+
+    // Destination regions of a single copy must not overlap, so overlapped uploads are submitted first.
+    for (const texture_upload& upload : data->texture_uploads) {
+        const irect staged{ upload.copy.imageOffset.x, upload.copy.imageOffset.y, int(upload.copy.imageExtent.width), int(upload.copy.imageExtent.height) };
 
-    // Transfer pixels into buffer.
-    void* ptr;
-    vk(vmaMapMemory(data->allocator, staging_buffer_allocation, &ptr));
-    memcpy(ptr, pixels, buffer_info.size);
-    vmaUnmapMemory(data->allocator, staging_buffer_allocation);
+        if (upload.texture_id == id && upload.copy.imageSubresource.mipLevel == 0 && staged.intersects(rect)) {
+            submit_uploads(data);
+            break;
+        }
+    }
 
-    // Create temporary buffer
-    VkCommandBufferAllocateInfo command_buffer_info{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-    command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    command_buffer_info.commandPool = data->command_pool;
-    command_buffer_info.commandBufferCount = 1;
+    const uvec2 size{ unsigned(rect.size.x), unsigned(rect.size.y) };
+    const size_t row_size = rb::texture::memory_size({ size.x, 1 }, texture.format);
+    const size_t region_size = rb::texture::memory_size(size, texture.format);
 
-    VkCommandBuffer command_buffer;
-    vkAllocateCommandBuffers(data->device, &command_buffer_info, &command_buffer);
+    // Rows are packed tightly.
+    const VkDeviceSize offset = allocate_staging(data, region_size);
+
+    auto source = static_cast<const uint8_t*>(pixels);
+    for (size_t row = 0; row < region_size / row_size; ++row) {
+        memcpy(data->staging.mapped + offset + row * row_size, source + row * stride, row_size);
+    }
+
+    // Images are created undefined, so the first upload transitions all levels as a whole upload does.
+    texture_upload upload;
+    upload.texture_id = id;
+    upload.whole = !texture.initialized;
+    upload.copy.bufferOffset = offset;
+    upload.copy.bufferRowLength = 0;
+    upload.copy.bufferImageHeight = 0;
+    upload.copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    upload.copy.imageSubresource.mipLevel = 0;
+    upload.copy.imageSubresource.baseArrayLayer = 0;
+    upload.copy.imageSubresource.layerCount = 1;
+    upload.copy.imageOffset = { rect.position.x, rect.position.y, 0 };
+    upload.copy.imageExtent = { size.x, size.y, 1 };
+    data->texture_uploads.push_back(upload);
+    texture.initialized = true;
+}
+
+void vku::update_texture_descriptor(std::unique_ptr<renderer::data>& data, handle id) {
+    const texture_data& texture = data->textures[id];
+
+    VkDescriptorImageInfo descriptor_image_info{};
+    descriptor_image_info.sampler = texture.sampler;
+    descriptor_image_info.imageView = texture.image_view;
+    descriptor_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write_info{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    write_info.dstSet = data->main_descriptor_set;
+    write_info.dstBinding = 0;
+    write_info.dstArrayElement = std::uint32_t(handle_index(id));
+    write_info.descriptorCount = 1;
+    write_info.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write_info.pImageInfo = &descriptor_image_info;
+    vkUpdateDescriptorSets(data->device, 1, &write_info, 0, nullptr);
+}
+
+void vku::submit_uploads(std::unique_ptr<renderer::data>& data) {
+    if (data->texture_uploads.empty()) {
+        return;
+    }
+
+    // Reuse a retired batch if there is one.
+    upload_batch batch;
+    if (!data->free_upload_batches.empty()) {
+        batch = data->free_upload_batches.back();
+        data->free_upload_batches.pop_back();
+    } else {
+        VkCommandBufferAllocateInfo command_buffer_info{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_buffer_info.commandPool = data->command_pool;
+        command_buffer_info.commandBufferCount = 1;
+        vk(vkAllocateCommandBuffers(data->device, &command_buffer_info, &batch.command_buffer));
+
+        VkFenceCreateInfo fence_info{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        vk(vkCreateFence(data->device, &fence_info, nullptr, &batch.fence));
+    }
+
+    vkResetCommandBuffer(batch.command_buffer, 0);
 
     VkCommandBufferBeginInfo begin_info{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
     begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    begin_info.pInheritanceInfo = nullptr;
-
-    // Begin registering commands
-    vkBeginCommandBuffer(command_buffer, &begin_info);
-
-    VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = texture.image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { texture.size.x, texture.size.y, 1 };
-    vkCmdCopyBufferToImage(command_buffer, staging_buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = texture.image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-    // End registering commands
-    vkEndCommandBuffer(command_buffer);
+    vkBeginCommandBuffer(batch.command_buffer, &begin_info);
 
+    // Uploads are grouped by texture, so every texture is updated by a single copy.
+    std::stable_sort(data->texture_uploads.begin(), data->texture_uploads.end(), [](const texture_upload& a, const texture_upload& b) {
+        return a.texture_id < b.texture_id;
+    });
+
+    std::vector<VkBufferImageCopy> copies(data->texture_uploads.size());
+    std::vector<VkImageMemoryBarrier> barriers;
+
+    for (size_t i = 0; i < data->texture_uploads.size(); ++i) {
+        const texture_upload& upload = data->texture_uploads[i];
+        copies[i] = upload.copy;
+
+        if (i > 0 && upload.texture_id == data->texture_uploads[i - 1].texture_id) {
+            continue;
+        }
+
+        const texture_data& texture = data->textures[upload.texture_id];
+
+        // Previous content of textures replaced as a whole, or never uploaded before, is discarded.
+        VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        barrier.oldLayout = upload.whole ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = texture.image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = upload.whole ? texture.mip_count : 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = upload.whole ? 0 : VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers.push_back(barrier);
+    }
+
+    vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, uint32_t(barriers.size()), barriers.data());
+
+    size_t first = 0;
+    for (const VkImageMemoryBarrier& barrier : barriers) {
+        size_t last = first + 1;
+        while (last < copies.size() && data->texture_uploads[last].texture_id == data->texture_uploads[first].texture_id) {
+            ++last;
+        }
+
+        vkCmdCopyBufferToImage(batch.command_buffer, data->staging.buffer, barrier.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, uint32_t(last - first), copies.data() + first);
+        first = last;
+    }
+
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+
+    vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, uint32_t(barriers.size()), barriers.data());
+
+    vkEndCommandBuffer(batch.command_buffer);
+
+    // Frames submitted later are ordered after the copies by the barrier,
+    // so nothing waits for the batch except reuse of its staging memory.
     VkSubmitInfo submit_info{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
     submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &command_buffer;
+    submit_info.pCommandBuffers = &batch.command_buffer;
+    vk(vkQueueSubmit(data->graphics_queue, 1, &submit_info, batch.fence));
 
-    vkQueueSubmit(data->graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-    vkQueueWaitIdle(data->graphics_queue);
+    batch.staging_end = data->staging.head;
+    data->upload_batches.push_back(batch);
+    data->texture_uploads.clear();
+}
 
-    vkFreeCommandBuffers(data->device, data->command_pool, 1, &command_buffer);
+bool vku::retire_upload_batch(std::unique_ptr<renderer::data>& data, bool wait) {
+    if (data->upload_batches.empty()) {
+        return false;
+    }
+
+    upload_batch& batch = data->upload_batches.front();
+    if (wait) {
+        vk(vkWaitForFences(data->device, 1, &batch.fence, VK_TRUE, UINT64_MAX));
+    } else if (vkGetFenceStatus(data->device, batch.fence) != VK_SUCCESS) {
+        return false;
+    }
+
+    // Batches complete in submission order, so staging memory is freed from the tail.
+    vkResetFences(data->device, 1, &batch.fence);
+    data->staging.tail = batch.staging_end;
+
+    data->free_upload_batches.push_back(batch);
+    data->upload_batches.pop_front();
+    return true;
+}
+
+void vku::discard_texture_uploads(std::unique_ptr<renderer::data>& data, handle id) {
+    // Staging memory of discarded uploads is freed together with the next batch.
+    data->texture_uploads.erase(std::remove_if(data->texture_uploads.begin(), data->texture_uploads.end(), [id](const texture_upload& upload) {
+        return upload.texture_id == id;
+    }), data->texture_uploads.end());
+}
+
+void vku::cleanup_staging_ring(std::unique_ptr<renderer::data>& data) {
+    if (data->staging.buffer) {
+        vmaDestroyBuffer(data->allocator, data->staging.buffer, data->staging.allocation);
+    }
 
-    vmaDestroyBuffer(data->allocator, staging_buffer, staging_buffer_allocation);
+    data->staging = {};
 }
 
 void vku::cleanup_texture(std::unique_ptr<renderer::data>& data, texture_data& texture) {
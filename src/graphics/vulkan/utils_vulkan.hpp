@@ -30,9 +30,25 @@ namespace rb::vku {
 
 	VkFilter get_filter(texture_filter filter);
 
-	texture_data create_texture(std::unique_ptr<renderer::data>& data, const uvec2& size, texture_filter filter, pixel_format format);
+	texture_data create_texture(std::unique_ptr<renderer::data>& data, const uvec2& size, texture_filter filter, pixel_format format, uint32_t mip_count);
 
-	void update_texture(std::unique_ptr<renderer::data>& data, texture_data& texture, const void* pixels);
+	void create_staging_ring(std::unique_ptr<renderer::data>& data, VkDeviceSize size);
+
+	VkDeviceSize allocate_staging(std::unique_ptr<renderer::data>& data, VkDeviceSize size);
+
+	void update_texture(std::unique_ptr<renderer::data>& data, handle id, const void* pixels);
+
+	void stage_texture_region(std::unique_ptr<renderer::data>& data, handle id, const irect& rect, const void* pixels, size_t stride);
+
+	void update_texture_descriptor(std::unique_ptr<renderer::data>& data, handle id);
+
+	void submit_uploads(std::unique_ptr<renderer::data>& data);
+
+	bool retire_upload_batch(std::unique_ptr<renderer::data>& data, bool wait);
+
+	void discard_texture_uploads(std::unique_ptr<renderer::data>& data, handle id);
+
+	void cleanup_staging_ring(std::unique_ptr<renderer::data>& data);
 
 	void cleanup_texture(std::unique_ptr<renderer::data>& data, texture_data& texture);
 }
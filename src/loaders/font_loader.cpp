@@ -1,22 +1,19 @@
 #include <rabbit/loaders/font_loader.hpp>
-#include <rabbit/graphics/image.hpp>
-
-#include <vector>
-#include <fstream>
 
 using namespace rb;
 
-font_loader::font_loader(renderer& renderer)
-    : m_renderer(renderer) {
+font_loader::font_loader(renderer& renderer, const pack* pack)
+    : m_renderer(renderer), m_pack(pack) {
 }
 
 font font_loader::operator()(std::string_view path) const {
-    std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
+    return finish(decode(path));
+}
 
-    std::vector<unsigned char> buffer(size);
-    file.read((char*)buffer.data(), size);
+file_view font_loader::decode(std::string_view path) const {
+    return open_file(m_pack, path);
+}
 
-    return { m_renderer, buffer };
+font font_loader::finish(file_view file) const {
+    return { m_renderer, file.bytes() };
 }
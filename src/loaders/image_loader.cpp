@@ -2,6 +2,11 @@
 
 using namespace rb;
 
+image_loader::image_loader(const pack* pack)
+    : m_pack(pack) {
+}
+
 image image_loader::operator()(std::string_view path) const {
-    return image::from(path);
+    const file_view file = open_file(m_pack, path);
+    return image::from_memory(file.bytes());
 }
@@ -1,14 +1,33 @@
 #include <rabbit/loaders/json_loader.hpp>
 
-#include <fstream>
+#include <algorithm>
 
 using namespace rb;
 
+namespace {
+    /**
+     * @brief Cooked json signature, followed by MessagePack data.
+     */
+    constexpr std::uint8_t cooked_magic[] = { 'R', 'B', 'J', 'S' };
+}
+
+json_loader::json_loader(const pack* pack)
+    : m_pack(pack) {
+}
+
 json json_loader::operator()(std::string_view path) const {
-    std::ifstream stream(std::string(path), std::ios::in);
-    assert(stream.is_open());
+    const file_view file = open_file(m_pack, path);
+    const span<const std::uint8_t> bytes = file.bytes();
+
+    if (bytes.size() >= sizeof(cooked_magic) && std::equal(std::begin(cooked_magic), std::end(cooked_magic), bytes.begin())) {
+        return json::from_msgpack(bytes.begin() + sizeof(cooked_magic), bytes.end());
+    }
+
+    return json::parse(bytes.begin(), bytes.end());
+}
 
-    json json;
-    stream >> json;
-    return json;
+std::vector<std::uint8_t> json_loader::cook(const json& value) {
+    std::vector<std::uint8_t> cooked(std::begin(cooked_magic), std::end(cooked_magic));
+    json::to_msgpack(value, cooked);
+    return cooked;
 }
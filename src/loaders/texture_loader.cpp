@@ -1,16 +1,149 @@
 #include <rabbit/loaders/texture_loader.hpp>
-#include <rabbit/graphics/image.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
 
 using namespace rb;
 
-texture_loader::texture_loader(renderer& renderer)
-    : m_renderer(renderer) {
+namespace {
+    /**
+     * @brief Cooked texture signature, "RBTX".
+     */
+    constexpr std::uint32_t cooked_magic = 0x58544252;
+
+    /**
+     * @brief Cooked texture format version.
+     */
+    constexpr std::uint32_t cooked_version = 1;
+
+    /**
+     * @brief Cooked texture header, followed by pixels of all mipmap levels.
+     */
+    struct cooked_header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t format;
+        std::uint32_t mip_count;
+    };
+
+    bool is_block_compressed(pixel_format format) {
+        return format == pixel_format::bc1 || format == pixel_format::bc3;
+    }
+
+    bool is_valid_format(std::uint32_t format) {
+        return format > std::uint32_t(pixel_format::undefined) && format <= std::uint32_t(pixel_format::bc3);
+    }
+
+    /**
+     * @brief Read cooked texture header and pixels.
+     *
+     * @return True if file is a cooked texture, false if it is an image file.
+     *         Throws std::runtime_error if cooked texture is corrupted.
+     */
+    bool read_cooked(texture_source& source) {
+        const span<const std::uint8_t> bytes = source.file.bytes();
+        if (bytes.size() < sizeof(cooked_header)) {
+            return false;
+        }
+
+        cooked_header header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+
+        if (header.magic != cooked_magic) {
+            return false;
+        }
+
+        // Header is validated before use, so corrupted packs fail to load instead of reading out of bounds.
+        // Every format takes at least half a byte per pixel, which bounds the size before computing memory size.
+        const uvec2 size{ header.width, header.height };
+        if (header.version != cooked_version || !is_valid_format(header.format) || size.x == 0 || size.y == 0 ||
+            std::uint64_t(size.x) * size.y / 2 > bytes.size() || header.mip_count == 0 || header.mip_count > image::mip_count(size) ||
+            texture::memory_size(size, pixel_format(header.format), header.mip_count) != bytes.size() - sizeof(cooked_header)) {
+            throw std::runtime_error("Corrupted cooked texture");
+        }
+
+        source.size = size;
+        source.format = pixel_format(header.format);
+        source.mip_count = header.mip_count;
+        source.pixels = bytes.subspan(sizeof(cooked_header));
+        return true;
+    }
+}
+
+texture_loader::texture_loader(renderer& renderer, const pack* pack, bool mipmaps)
+    : m_renderer(renderer), m_pack(pack), m_mipmaps(mipmaps) {
 }
 
 texture texture_loader::operator()(std::string_view path) const {
-    image image = image::from(path, true);
+    return finish(decode(path));
+}
+
+texture_source texture_loader::decode(std::string_view path) const {
+    texture_source source{ {}, pixel_format::rgba8, 1, {}, open_file(m_pack, path), std::nullopt, {} };
+
+    if (!read_cooked(source)) {
+        source.decoded = image::from_memory(source.file.bytes(), true);
+        source.size = source.decoded->size();
+        source.pixels = source.decoded->pixels();
 
-    texture texture(m_renderer, image.size(), texture_filter::nearest, pixel_format::rgba8);
-    texture.update(image.pixels().data());
+        // Encoded file is not needed anymore.
+        source.file = file_view();
+
+        if (m_mipmaps) {
+            source.mip_count = image::mip_count(source.size);
+            source.levels.reserve(texture::memory_size(source.size, source.format, source.mip_count));
+            source.levels.assign(source.pixels.begin(), source.pixels.end());
+
+            for (const image& level : source.decoded->mipmaps()) {
+                source.levels.insert(source.levels.end(), level.pixels().begin(), level.pixels().end());
+            }
+
+            source.pixels = source.levels;
+            source.decoded.reset();
+        }
+    }
+
+    return source;
+}
+
+texture texture_loader::finish(texture_source source) const {
+    texture texture(m_renderer, source.size, texture_filter::nearest, source.format, source.mip_count);
+    texture.update(source.pixels.data());
     return texture;
 }
+
+std::vector<std::uint8_t> texture_loader::cook(const image& image, pixel_format format, bool generate_mipmaps, s3tc_quality quality) {
+    assert(format == pixel_format::rgba8 || is_block_compressed(format));
+
+    std::vector<std::uint8_t> cooked(sizeof(cooked_header));
+    cooked_header header{ cooked_magic, cooked_version, image.size().x, image.size().y, std::uint32_t(format), 0 };
+
+    const s3tc encoder{ quality };
+    const std::vector<rb::image> mipmaps = generate_mipmaps ? image.mipmaps() : std::vector<rb::image>();
+
+    header.mip_count = std::uint32_t(mipmaps.size() + 1);
+    cooked.resize(sizeof(cooked_header) + texture::memory_size(image.size(), format, header.mip_count));
+
+    // Levels smaller than a block are padded to a whole block by the encoder.
+    std::size_t offset = sizeof(cooked_header);
+    for (std::uint32_t level = 0; level < header.mip_count; ++level) {
+        const rb::image& source = level == 0 ? image : mipmaps[level - 1];
+
+        if (format == pixel_format::bc1) {
+            encoder.bc1(source.pixels().data(), source.pixels().size_bytes(), source.stride(), cooked.data() + offset);
+        } else if (format == pixel_format::bc3) {
+            encoder.bc3(source.pixels().data(), source.pixels().size_bytes(), source.stride(), cooked.data() + offset);
+        } else {
+            std::memcpy(cooked.data() + offset, source.pixels().data(), source.pixels().size_bytes());
+        }
+
+        offset += texture::memory_size(source.size(), format);
+    }
+
+    std::memcpy(cooked.data(), &header, sizeof(header));
+    return cooked;
+}
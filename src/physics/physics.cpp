@@ -19,7 +19,7 @@ struct physics::data {
     b2World world = b2World(b2Vec2(0.0f, 100.0f));
 
     arena<shape_data> shapes;
-    arena<body_data> bodies;
+    arena<body_data, 1024> bodies;
 };
 
 physics::physics()
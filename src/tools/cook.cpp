@@ -0,0 +1,193 @@
+#include <rabbit/core/pack.hpp>
+#include <rabbit/core/parallel.hpp>
+#include <rabbit/core/thread_pool.hpp>
+#include <rabbit/graphics/font.hpp>
+#include <rabbit/graphics/image.hpp>
+#include <rabbit/loaders/json_loader.hpp>
+#include <rabbit/loaders/texture_loader.hpp>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <numeric>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+// Usage: rabbit-cook [options] <input directory> <output pack>
+// Converts assets to the form they are used in at runtime and writes them into a pack:
+// images become textures in GPU format with mipmaps, fonts get glyphs rasterized into atlas,
+// json becomes binary. Other files are stored as is. Files are named by their path relative
+// to parent of the input directory, e.g. cooking "data" produces "data/buddy.png".
+
+namespace {
+    struct options {
+        std::string texture_format = "auto";
+        rb::s3tc_quality texture_quality = rb::s3tc_quality::best;
+        bool mipmaps = true;
+        unsigned int font_size = 13;
+        unsigned int first_glyph = 32;
+        unsigned int last_glyph = 126;
+        unsigned int thread_count = std::thread::hardware_concurrency();
+    };
+
+    struct cooked_file {
+        std::string path;
+        std::vector<std::uint8_t> data;
+        bool compress = true;
+        const char* kind = "raw";
+        std::string error;
+    };
+
+    std::vector<std::uint8_t> read(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("cannot open file");
+        }
+
+        return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    }
+
+    rb::pixel_format texture_format(const options& options, const rb::image& image) {
+        // Encoder pads edge blocks, so images of any size can be block compressed.
+        if (options.texture_format == "rgba8") {
+            return rb::pixel_format::rgba8;
+        } else if (options.texture_format == "bc1") {
+            return rb::pixel_format::bc1;
+        } else if (options.texture_format == "bc3") {
+            return rb::pixel_format::bc3;
+        }
+
+        // Opaque images do not need alpha block.
+        const rb::span<const std::uint8_t> pixels = image.pixels();
+        for (std::size_t i = 3; i < pixels.size(); i += 4) {
+            if (pixels[i] != 255) {
+                return rb::pixel_format::bc3;
+            }
+        }
+
+        return rb::pixel_format::bc1;
+    }
+
+    void cook(const options& options, const std::filesystem::path& path, cooked_file& file) {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+        std::vector<std::uint8_t> data = read(path);
+
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp") {
+            const rb::image image = rb::image::from_memory(data, true);
+            file.data = rb::texture_loader::cook(image, texture_format(options, image), options.mipmaps, options.texture_quality);
+            file.kind = "texture";
+        } else if (extension == ".ttf" || extension == ".otf") {
+            std::vector<unsigned int> codepoints(options.last_glyph - options.first_glyph + 1);
+            std::iota(codepoints.begin(), codepoints.end(), options.first_glyph);
+
+            file.data = rb::font::cook(data, options.font_size, codepoints);
+            file.kind = "font";
+        } else if (extension == ".json") {
+            file.data = rb::json_loader::cook(rb::json::parse(data.begin(), data.end()));
+            file.kind = "json";
+        } else {
+            file.data = std::move(data);
+
+            // Already compressed formats do not shrink any further.
+            file.compress = extension != ".ogg" && extension != ".mp3" && extension != ".zip";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    options options;
+    std::vector<std::string> arguments;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+
+        if (argument == "--texture-format" && i + 1 < argc) {
+            options.texture_format = argv[++i];
+        } else if (argument == "--texture-quality" && i + 1 < argc) {
+            const std::string quality = argv[++i];
+            options.texture_quality = quality == "fast" ? rb::s3tc_quality::fast : quality == "normal" ? rb::s3tc_quality::normal : rb::s3tc_quality::best;
+        } else if (argument == "--no-mipmaps") {
+            options.mipmaps = false;
+        } else if (argument == "--font-size" && i + 1 < argc) {
+            options.font_size = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--glyphs" && i + 1 < argc) {
+            char* end;
+            options.first_glyph = (unsigned int)std::strtoul(argv[++i], &end, 10);
+            options.last_glyph = *end == '-' ? (unsigned int)std::strtoul(end + 1, nullptr, 10) : options.first_glyph;
+        } else if (argument == "--threads" && i + 1 < argc) {
+            options.thread_count = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            arguments.push_back(argument);
+        }
+    }
+
+    if (arguments.size() != 2 || options.font_size == 0 || options.last_glyph < options.first_glyph) {
+        std::fprintf(stderr, "usage: %s [--texture-format auto|rgba8|bc1|bc3] [--texture-quality fast|normal|best] [--no-mipmaps] [--font-size <pixels>] [--glyphs <first>-<last>] [--threads <count>] <input directory> <output pack>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path input = std::filesystem::absolute(arguments[0]);
+    const std::filesystem::path base = input.parent_path();
+
+    std::vector<std::filesystem::path> paths;
+    std::error_code error;
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error)) {
+        if (entry.is_regular_file()) {
+            paths.push_back(entry.path());
+        }
+    }
+
+    if (error) {
+        std::fprintf(stderr, "cannot read %s\n", arguments[0].c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::vector<cooked_file> files(paths.size());
+
+    rb::thread_pool pool(std::max(options.thread_count, 1u));
+    rb::parallel_for(pool, std::size_t(0), paths.size(), 1, [&](std::size_t index) {
+        files[index].path = paths[index].lexically_relative(base).generic_string();
+
+        // Failures are reported after all files are cooked, naming the file.
+        try {
+            cook(options, paths[index], files[index]);
+        } catch (const std::exception& exception) {
+            files[index].error = exception.what();
+        }
+    });
+
+    bool failed = false;
+    for (const cooked_file& file : files) {
+        if (!file.error.empty()) {
+            std::fprintf(stderr, "cannot cook %s: %s\n", file.path.c_str(), file.error.c_str());
+            failed = true;
+        }
+    }
+
+    if (failed) {
+        return EXIT_FAILURE;
+    }
+
+    rb::pack_writer writer;
+    for (cooked_file& file : files) {
+        std::printf("%-8s %10zu %s\n", file.kind, file.data.size(), file.path.c_str());
+        writer.add(file.path, std::move(file.data), file.compress);
+    }
+
+    if (!writer.save(arguments[1])) {
+        std::fprintf(stderr, "cannot write %s\n", arguments[1].c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::printf("cooked %zu files into %s\n", files.size(), arguments[1].c_str());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#include <rabbit/core/compressor.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+
+// Usage: train_dictionary <output> <capacity> <sample file or directory>...
+// Every file is a single sample, e.g. one captured network message or config file.
+// Directories are searched recursively.
+
+static bool read_sample(const std::filesystem::path& path, std::vector<std::vector<std::uint8_t>>& samples) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    samples.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::fprintf(stderr, "usage: %s <output> <capacity> <samples>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::size_t capacity = std::strtoul(argv[2], nullptr, 10);
+    if (capacity == 0) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::vector<std::uint8_t>> samples;
+
+    for (int i = 3; i < argc; ++i) {
+        std::error_code error;
+
+        if (std::filesystem::is_directory(argv[i], error)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[i], error)) {
+                if (entry.is_regular_file() && !read_sample(entry.path(), samples)) {
+                    return EXIT_FAILURE;
+                }
+            }
+        } else if (!read_sample(argv[i], samples)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::vector<std::uint8_t> dictionary = rb::compressor::train_dictionary(samples, capacity);
+    if (dictionary.empty()) {
+        std::fprintf(stderr, "samples have nothing in common\n");
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream output(argv[1], std::ios::binary);
+    if (!output.write((const char*)dictionary.data(), std::streamsize(dictionary.size()))) {
+        return EXIT_FAILURE;
+    }
+
+    std::printf("trained %zu bytes dictionary from %zu samples\n", dictionary.size(), samples.size());
+    return EXIT_SUCCESS;
+}